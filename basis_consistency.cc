@@ -22,6 +22,9 @@
 
 #include "basis_consistency.h"
 #include "pairing.h"
+#include "worker_pool.h"
+#include "basis_rows.h"
+#include "lane_kernels.h"
 #include <tuple>
 #include <vector>
 #include <iostream>
@@ -29,6 +32,15 @@
 #include <algorithm>
 #include <thread>
 #include <future>
+#include <chrono>
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <array>
+#include <utility>
+#include <memory>
+#include <cstring>
+#include <stdexcept>
 
 // lookup tables to eliminate conditional logic.
 
@@ -416,22 +428,14 @@ void debug_06(std::vector<uint8_t>& term_states,
 }
 
 // propagate term states to pairs then propage the pair
-// state back down to the terms.
-UpdateResult update_pair_states(Index i, Index j,
-				std::vector<uint8_t>& term_states,
-				std::vector<uint8_t>& pair_states) {
+// state back down to the terms.  works on local copies of the three
+// states and leaves writing them back to the caller.
+static UpdateResult propagate_pair_states(uint8_t& term_i,
+					  uint8_t& term_j,
+					  uint8_t& pair_ij) {
   // Save original states to detect changes
-  uint8_t &term_i = term_states[i];
   uint8_t term_i_orig = term_i;
-
-  uint8_t &term_j = term_states[j];
   uint8_t term_j_orig = term_j;
-
-  // Get pair indices
-  Index ij_idx = pair2d(i, j);
-    
-  // Save original pair states
-  uint8_t &pair_ij = pair_states[ij_idx];
   uint8_t pair_ij_orig = pair_ij;
 
   // update the pairs and basis from the terms
@@ -491,6 +495,71 @@ UpdateResult update_pair_states(Index i, Index j,
   return UpdateResult(false, false);
 }
 
+template <typename TermStates, typename PairStates>
+UpdateResult update_pair_states(Index i, Index j,
+				TermStates& term_states,
+				PairStates& pair_states) {
+  Index ij_idx = pair2d(i, j);
+  uint8_t term_i = term_states[i];
+  uint8_t term_j = term_states[j];
+  uint8_t pair_ij = pair_states[ij_idx];
+  UpdateResult result = propagate_pair_states(term_i, term_j, pair_ij);
+  if (result.changed) {
+    term_states[i] &= term_i;
+    term_states[j] &= term_j;
+    pair_states[ij_idx] &= pair_ij;
+  }
+  return result;
+}
+
+template UpdateResult update_pair_states(Index, Index,
+					 std::vector<uint8_t>&,
+					 std::vector<uint8_t>&);
+template UpdateResult update_pair_states(Index, Index,
+					 std::vector<uint8_t>&,
+					 PackedStates<4>&);
+template UpdateResult update_pair_states(Index, Index,
+					 PackedStates<2>&,
+					 PackedStates<4>&);
+template UpdateResult update_pair_states(Index, Index,
+					 FixedStates&,
+					 FixedStates&);
+
+// Workers running in shared-state mode update one store
+// concurrently.  states only ever lose bits so a relaxed atomic AND
+// is all the synchronization a write needs.  single threaded callers
+// instantiate these with Shared = false and get plain accesses.
+template <bool Shared>
+static inline uint8_t load_state(const uint8_t& state) {
+  if (Shared) {
+    return __atomic_load_n(&state, __ATOMIC_RELAXED);
+  }
+  return state;
+}
+
+template <bool Shared>
+static inline void and_state(uint8_t& state, uint8_t mask) {
+  if (Shared) {
+    __atomic_fetch_and(&state, mask, __ATOMIC_RELAXED);
+  } else {
+    state &= mask;
+  }
+}
+
+// the proxies PackedStates and ZeroPageStates hand out for a state.
+// those stores are never shared between workers.
+template <bool Shared, typename Ref>
+static inline uint8_t load_state(const Ref& state) {
+  static_assert(!Shared, "only byte stores can be shared");
+  return state;
+}
+
+template <bool Shared, typename Ref>
+static inline void and_state(Ref state, uint8_t mask) {
+  static_assert(!Shared, "only byte stores can be shared");
+  state &= mask;
+}
+
 // propagate term states to pairs to a basis then propage the basis
 // state back down to the pairs and terms.
 #if 0
@@ -617,39 +686,27 @@ UpdateResult update_basis_states(Index i, Index j, Index k,
   return UpdateResult(false, false);
 }
 #else
-// update_basis_states without lookup tables
-UpdateResult update_basis_states(Index i, Index j, Index k,
-                                Index basis_idx,
-                                std::vector<uint8_t>& term_states,
-                                std::vector<uint8_t>& pair_states,
-                                std::vector<uint8_t>& basis_states) {
+// update_basis_states without lookup tables.  works on local copies
+// of the seven states of basis (i,j,k) and leaves writing them back
+// to the caller.
+static UpdateResult propagate_basis_states(uint8_t& term_i,
+                                           uint8_t& term_j,
+                                           uint8_t& term_k,
+                                           uint8_t& pair_ij,
+                                           uint8_t& pair_ik,
+                                           uint8_t& pair_jk,
+                                           uint8_t& basis_ijk) {
     // Save original states to detect changes
-    uint8_t &term_i = term_states[i];
     uint8_t term_i_orig = term_i;
-
-    uint8_t &term_j = term_states[j];
     uint8_t term_j_orig = term_j;
-
-    uint8_t &term_k = term_states[k];
     uint8_t term_k_orig = term_k;
     
-    // Get pair indices
-    Index ij_idx = pair2d(i, j);
-    Index ik_idx = pair2d(i, k);
-    Index jk_idx = pair2d(j, k);
-    
     // Save original pair states
-    uint8_t &pair_ij = pair_states[ij_idx];
     uint8_t pair_ij_orig = pair_ij;
-
-    uint8_t &pair_ik = pair_states[ik_idx];
     uint8_t pair_ik_orig = pair_ik;
-    
-    uint8_t &pair_jk = pair_states[jk_idx];
     uint8_t pair_jk_orig = pair_jk;
     
     // Save original basis state
-    uint8_t &basis_ijk = basis_states[basis_idx];
     uint8_t basis_ijk_orig = basis_ijk;
 
     // Phase 1: Forward propagation (terms → pairs → basis)
@@ -856,223 +913,220 @@ UpdateResult update_basis_states(Index i, Index j, Index k,
     
     return UpdateResult(false, false);
 }
-#endif
 
-// First, define a fixed-size container for intermediary bases
-struct IntermediaryBasis {
-  Index basis_idx;
-  Index i;
-  Index j;
-  Index k;
-  unsigned int offset1, offset2, offset3;
-  uint8_t state;
-};
+// The state containers are those of a StateStore or, for the small
+// engine, plain uint8_t* into fixed size arrays
+template <bool Shared, typename TermStates, typename PairStates,
+          typename BasisStates>
+static UpdateResult update_basis_states_impl(Index i, Index j, Index k,
+                                             Index ij_idx,
+                                             Index ik_idx,
+                                             Index jk_idx,
+                                             Index basis_idx,
+                                             TermStates& term_states,
+                                             PairStates& pair_states,
+                                             BasisStates& basis_states) {
+    uint8_t term_i = load_state<Shared>(term_states[i]);
+    uint8_t term_j = load_state<Shared>(term_states[j]);
+    uint8_t term_k = load_state<Shared>(term_states[k]);
+    uint8_t pair_ij = load_state<Shared>(pair_states[ij_idx]);
+    uint8_t pair_ik = load_state<Shared>(pair_states[ik_idx]);
+    uint8_t pair_jk = load_state<Shared>(pair_states[jk_idx]);
+    uint8_t basis_ijk = load_state<Shared>(basis_states[basis_idx]);
+
+    UpdateResult result = propagate_basis_states(term_i, term_j, term_k,
+                                                 pair_ij, pair_ik, pair_jk,
+                                                 basis_ijk);
+    // the new states are subsets of what we loaded so writing them
+    // back is an AND
+    if (result.changed) {
+        and_state<Shared>(term_states[i], term_i);
+        and_state<Shared>(term_states[j], term_j);
+        and_state<Shared>(term_states[k], term_k);
+        and_state<Shared>(pair_states[ij_idx], pair_ij);
+        and_state<Shared>(pair_states[ik_idx], pair_ik);
+        and_state<Shared>(pair_states[jk_idx], pair_jk);
+        and_state<Shared>(basis_states[basis_idx], basis_ijk);
+    }
+    return result;
+}
+
+template <typename TermStates, typename PairStates, typename BasisStates>
+UpdateResult update_basis_states(Index i, Index j, Index k,
+                                Index ij_idx, Index ik_idx, Index jk_idx,
+                                Index basis_idx,
+                                TermStates& term_states,
+                                PairStates& pair_states,
+                                BasisStates& basis_states) {
+    return update_basis_states_impl<false>(i, j, k,
+                                           ij_idx, ik_idx, jk_idx,
+                                           basis_idx,
+                                           term_states,
+                                           pair_states,
+                                           basis_states);
+}
+
+template <typename TermStates, typename PairStates, typename BasisStates>
+UpdateResult update_basis_states(Index i, Index j, Index k,
+                                Index basis_idx,
+                                TermStates& term_states,
+                                PairStates& pair_states,
+                                BasisStates& basis_states) {
+    return update_basis_states(i, j, k,
+                               pair2d(i, j), pair2d(i, k), pair2d(j, k),
+                               basis_idx,
+                               term_states,
+                               pair_states,
+                               basis_states);
+}
+
+#define INSTANTIATE_UPDATE_BASIS_STATES(Store)                          \
+    template UpdateResult update_basis_states                           \
+    (Index, Index, Index, Index, Index, Index, Index,                   \
+     Store::TermStates&, Store::PairStates&, Store::BasisStates&);      \
+    template UpdateResult update_basis_states                           \
+    (Index, Index, Index, Index,                                        \
+     Store::TermStates&, Store::PairStates&, Store::BasisStates&);
+FOR_EACH_STATE_STORE(INSTANTIATE_UPDATE_BASIS_STATES)
+#endif
 
 // Maximum number of intermediary bases: (6 choose 3) - 2 original
 // bases = 18
 constexpr size_t MAX_INTERMEDIARY_BASES = 18;
 
-// Intermediary is a tuple of the basis index, the three term
-// offsets, and a new basis state.  intermediary bases are composed
-// of one term from one basis and two terms from the other.  the key
-// insight here is that these intermediaries are first made
-// conconsistent and representative (wrt consistency with basis1 and
-// basis2) of all other bases that share terms by calling
-// update_basis_states.  A conflict with a representative
-// intermediary basis (a,b,c) is representative of all possible
-// other bases (a,b,X), (a,X,c), (X,b,c),(a,X,Y),(X,b,Y),(X,Y,c) and
-// once basis(a,b,c) is trimmed of states that are inconsistent with
-// basis1, basis2, and all the other representative intermediary
-// bases, the global state is made consistent by calling
-// update_basis_states on (a,b,c).
-void generate_intermediaries(const Index* b1_array,
-			     const Index* b2_array,
-			     IntermediaryBasis* intermediaries,
-			     size_t* num_intermediaries) {
-    
-  // Merged array of terms and their offsets
-  Index all_terms[6];
-  unsigned int all_offsets[6];
-  size_t term_count = 0;
-    
-  // Parallel traversal of both sorted arrays (same as before)
-  int i = 0, j = 0;
-  while (i < 3 && j < 3) {
-    if (b1_array[i] < b2_array[j]) {
-      all_terms[term_count] = b1_array[i];
-      all_offsets[term_count] = i;
-      term_count++;
-      i++;
-    } else if (b1_array[i] > b2_array[j]) {
-      all_terms[term_count] = b2_array[j];
-      all_offsets[term_count] = j + 3;
-      term_count++;
-      j++;
-    } else {
-      all_terms[term_count] = b1_array[i];
-      all_offsets[term_count] = i;
-      term_count++;
-      i++;
-      j++;
+static BasisKernel active_basis_kernel = BasisKernel::BITSLICED;
+
+void set_basis_kernel(BasisKernel kernel) {
+  active_basis_kernel = kernel;
+}
+
+BasisKernel basis_kernel() {
+  return active_basis_kernel;
+}
+
+// How the terms of two bases interleave.  merging the two sorted
+// triples gives 4, 5 or 6 distinct terms (the bases share 2, 1 or 0
+// terms).  everything ensure_basis_consistency needs to know about
+// the intermediaries follows from the interleaving alone.
+//
+// terms are named by their offset in (i1, j1, k1, i2, j2, k2), which
+// is also their offset into joint_states.  a term both bases share
+// is named by its basis1 offset.
+struct MergePattern {
+  size_t num_intermediaries;
+  // the terms of each intermediary in increasing order, listed in
+  // merged order (a < b < c over the merged terms) skipping basis1
+  // and basis2 themselves
+  uint8_t offsets[MAX_INTERMEDIARY_BASES][3];
+};
+
+// 20 interleavings of 6 terms, 30 of 5 and 12 of 4
+constexpr size_t NUM_MERGE_PATTERNS = 62;
+
+// An interleaving is identified by where each basis1 term falls among
+// the basis2 terms: rank = how many basis2 terms are smaller and equal
+// = whether one of them is the same term.  (rank * 2 + equal) of i1,
+// j1 and k1 packed 3 bits apiece gives a 9 bit key.
+constexpr size_t MERGE_KEY_COUNT = 512;
+
+struct MergePatternTables {
+  std::array<MergePattern, NUM_MERGE_PATTERNS> patterns;
+  uint8_t index[MERGE_KEY_COUNT];
+};
+
+static constexpr MergePatternTables build_merge_pattern_tables() {
+  MergePatternTables tables{};
+  size_t count = 0;
+  for (size_t num_terms = 4; num_terms <= 6; num_terms++) {
+    size_t num_codes = 1;
+    for (size_t p = 0; p < num_terms; p++) {
+      num_codes *= 3;
     }
-  }
-    
-  // Add any remaining terms
-  while (i < 3) {
-    all_terms[term_count] = b1_array[i];
-    all_offsets[term_count] = i;
-    term_count++;
-    i++;
-  }
-    
-  while (j < 3) {
-    all_terms[term_count] = b2_array[j];
-    all_offsets[term_count] = j + 3;
-    term_count++;
-    j++;
-  }
-    
-  // Create indices for basis1 and basis2 to filter them out later
-  Index basis1_idx = pair3d(b1_array[0], b1_array[1], b1_array[2]);
-  Index basis2_idx = pair3d(b2_array[0], b2_array[1], b2_array[2]);
-    
-  // Reset counter
-  *num_intermediaries = 0;
-    
-  // Generate all combinations of 3 terms from the merged list
-  for (size_t i = 0;
-       ((i < term_count) &&
-	(*num_intermediaries < MAX_INTERMEDIARY_BASES));
-       i++) {
-    for (size_t j = i + 1;
-	 ((j < term_count) &&
-	  (*num_intermediaries < MAX_INTERMEDIARY_BASES));
-	 j++) {
-      for (size_t k = j + 1;
-	   ((k < term_count) &&
-	    (*num_intermediaries < MAX_INTERMEDIARY_BASES));
-	   k++) {
-	// Create basis index
-	Index basis_idx =
-	  pair3d(all_terms[i], all_terms[j], all_terms[k]);
-                
-	// Skip if this is one of the original bases
-	if (basis_idx == basis1_idx || basis_idx == basis2_idx) {
-	  continue;
+    for (size_t code = 0; code < num_codes; code++) {
+      uint8_t sources[6] = {0, 0, 0, 0, 0, 0};
+      size_t in_basis1 = 0, in_basis2 = 0;
+      size_t digits = code;
+      for (size_t p = 0; p < num_terms; p++) {
+	sources[p] = 1 + digits % 3;
+	digits /= 3;
+	in_basis1 += sources[p] & 1;
+	in_basis2 += sources[p] >> 1;
+      }
+      if (in_basis1 != 3 || in_basis2 != 3) {
+	continue;
+      }
+      MergePattern& pattern = tables.patterns[count];
+      uint8_t term_offsets[6] = {0, 0, 0, 0, 0, 0};
+      uint8_t offset1 = 0, offset2 = 0;
+      size_t key = 0;
+      for (size_t p = 0; p < num_terms; p++) {
+	if (sources[p] & 1) {
+	  // offset2 basis2 terms came before this basis1 term
+	  key |= (offset2 * 2 + (sources[p] >> 1)) << (3 * offset1);
+	  term_offsets[p] = offset1++;
+	  offset2 += sources[p] >> 1;
+	} else {
+	  term_offsets[p] = 3 + offset2++;
+	}
+      }
+      tables.index[key] = count;
+      count++;
+      // every triple except basis1 and basis2 themselves
+      size_t num_intermediaries = 0;
+      for (size_t a = 0; a < num_terms; a++) {
+	for (size_t b = a + 1; b < num_terms; b++) {
+	  for (size_t c = b + 1; c < num_terms; c++) {
+	    uint8_t shared = sources[a] & sources[b] & sources[c];
+	    if (shared) {
+	      continue;
+	    }
+	    pattern.offsets[num_intermediaries][0] = term_offsets[a];
+	    pattern.offsets[num_intermediaries][1] = term_offsets[b];
+	    pattern.offsets[num_intermediaries][2] = term_offsets[c];
+	    num_intermediaries++;
+	  }
 	}
-                
-	// Add intermediary with pre-calculated offsets (using fixed
-	// array)
-	intermediaries[*num_intermediaries].basis_idx = basis_idx;
-	intermediaries[*num_intermediaries].i = all_terms[i];
-	intermediaries[*num_intermediaries].j = all_terms[j];
-	intermediaries[*num_intermediaries].k = all_terms[k];
-	intermediaries[*num_intermediaries].offset1 = all_offsets[i];
-	intermediaries[*num_intermediaries].offset2 = all_offsets[j];
-	intermediaries[*num_intermediaries].offset3 = all_offsets[k];
-	intermediaries[*num_intermediaries].state = 0;
-                
-	(*num_intermediaries)++;
       }
+      pattern.num_intermediaries = num_intermediaries;
     }
   }
+  return tables;
 }
 
-UpdateResult ensure_basis_consistency
-(Index i1,
- Index j1,
- Index k1,
- Index i2,
- Index j2,
- Index k2,
- Index basis1_idx,
- Index basis2_idx,
- std::vector<uint8_t>& term_states,
- std::vector<uint8_t>& pair_states,
- std::vector<uint8_t>& basis_states) {
-
-  // First update each basis individually
-  UpdateResult result = update_basis_states(i1, j1, k1,
-					    basis1_idx,
-					    term_states,
-					    pair_states,
-					    basis_states);
-  
-  if(result.has_zero) {
-    return result;
-  }
-  // make basis2 consistent with basis1
-  UpdateResult basis2_result = update_basis_states(i2, j2, k2,
-						   basis2_idx,
-						   term_states,
-						   pair_states,
-						   basis_states);
-  if(basis2_result.has_zero) {
-    return basis2_result;
-  }
-  result.changed = result.changed || basis2_result.changed;
+static constexpr MergePatternTables merge_pattern_tables =
+  build_merge_pattern_tables();
 
-  // make basis1 consistent with basis2
-  result = update_basis_states(i1, j1, k1,
-			       basis1_idx,
-			       term_states,
-			       pair_states,
-			       basis_states);
-  if(result.has_zero) {
-    return result;
-  }
-    
-  // Setup for intermediary generation
-  Index b1_array[] = {i1, j1, k1};
-  Index b2_array[] = {i2, j2, k2};
-    
-  // Use stack-allocated array for intermediaries
-  IntermediaryBasis intermediaries[MAX_INTERMEDIARY_BASES];
-  size_t num_intermediaries = 0;
-    
-  // Generate intermediaries directly from the variable triplets
-  generate_intermediaries(b1_array,
-			  b2_array,
-			  intermediaries,
-			  &num_intermediaries);
-    
-  // Update all intermediary bases
-  bool any_changed;
-  do {
-    any_changed = false;
-    for (size_t idx = 0; idx < num_intermediaries; idx++) {
-      // We still need to unpack this one intermediary basis
-      UpdateResult inter_result =
-	update_basis_states(intermediaries[idx].i,
-			    intermediaries[idx].j,
-			    intermediaries[idx].k,
-			    intermediaries[idx].basis_idx,
-			    term_states,
-			    pair_states,
-			    basis_states);
-      if (inter_result.has_zero) {
-	return inter_result;
-      }
-      any_changed |= inter_result.changed;
-    }
-  } while (any_changed);
-  // Calculate consistent states
-  uint8_t &basis1_state = basis_states[basis1_idx];
-  uint8_t &basis2_state = basis_states[basis2_idx];
-    
-  uint8_t new_basis1_state = 0;
-  uint8_t new_basis2_state = 0;
-    
-  // Pre-compute pair indices to avoid recalculation
-  Index ij1_idx = pair2d(i1, j1);
-  Index ik1_idx = pair2d(i1, k1);
-  Index jk1_idx = pair2d(j1, k1);
-  Index ij2_idx = pair2d(i2, j2);
-  Index ik2_idx = pair2d(i2, k2);
-  Index jk2_idx = pair2d(j2, k2);
+// Index of the interleaving of bp in merge_pattern_tables.patterns,
+// from nine branch free comparisons instead of a merge
+static inline size_t classify_basis_pair(const BasisPair& bp) {
+  auto key = [&bp](Index term) {
+    size_t rank = (bp.i2 < term) + (bp.j2 < term) + (bp.k2 < term);
+    size_t equal = (bp.i2 == term) | (bp.j2 == term) | (bp.k2 == term);
+    return rank * 2 + equal;
+  };
+  return merge_pattern_tables.index[key(bp.i1) |
+				    (key(bp.j1) << 3) |
+				    (key(bp.k1) << 6)];
+}
 
+// The combination step of ensure_basis_consistency: a state of basis1
+// and a state of basis2 survive together only if every intermediary
+// still allows the state they imply for it.  computes the surviving
+// states of both bases and, in new_inter_states, the states of the
+// intermediaries that some surviving combination implies.
+//
+// reference version, one combination at a time
+template <size_t P>
+static void combine_bases_scalar(uint8_t basis1_state,
+				 uint8_t basis2_state,
+				 const uint8_t* inter_states,
+				 uint8_t* new_inter_states,
+				 uint8_t& new_basis1_state,
+				 uint8_t& new_basis2_state) {
+  constexpr const MergePattern& pattern = merge_pattern_tables.patterns[P];
+  constexpr size_t num_intermediaries = pattern.num_intermediaries;
   // Fixed-size array for intermediary proposals
-  uint8_t intermediary_proposals[MAX_INTERMEDIARY_BASES] = {0};
+  uint8_t intermediary_proposals[num_intermediaries] = {0};
     
   // For each set bit in basis1_state
   uint8_t basis1_bits = basis1_state;
@@ -1106,9 +1160,9 @@ UpdateResult ensure_basis_consistency
       // Calculate all required states first for better memory
       // locality
       for (size_t i = 0; i < num_intermediaries; i++) {
-	uint8_t i_state = joint_states[intermediaries[i].offset1];
-	uint8_t j_state = joint_states[intermediaries[i].offset2];
-	uint8_t k_state = joint_states[intermediaries[i].offset3];
+	uint8_t i_state = joint_states[pattern.offsets[i][0]];
+	uint8_t j_state = joint_states[pattern.offsets[i][1]];
+	uint8_t k_state = joint_states[pattern.offsets[i][2]];
   
 	intermediary_proposals[i] =
 	  threed_intermediary_set_masks[i_state][j_state][k_state];
@@ -1118,8 +1172,7 @@ UpdateResult ensure_basis_consistency
       // intermediaries
       bool consistent = true;
       for (size_t i = 0; i < num_intermediaries; i++) {
-	Index inter_idx = intermediaries[i].basis_idx;
-	if (!(basis_states[inter_idx] & intermediary_proposals[i])) {
+	if (!(inter_states[i] & intermediary_proposals[i])) {
 	  consistent = false;
 	  break;
 	}
@@ -1132,36 +1185,413 @@ UpdateResult ensure_basis_consistency
                         
 	// Update all intermediary state values
 	for (size_t i = 0; i < num_intermediaries; i++) {
-	  intermediaries[i].state |= intermediary_proposals[i];
+	  new_inter_states[i] |= intermediary_proposals[i];
+	}
+      }
+    }
+  }
+}
+
+// Lookup tables for combine_bases_bitsliced.  the 64 combinations of
+// a basis1 state bit a and a basis2 state bit b are the bits a * 8 + b
+// of a uint64_t.  implied[o1][o2][o3][v] has a combination's bit set
+// when it implies state bit v for an intermediary built from the terms
+// at offsets o1, o2, o3 (0-2 in basis1, 3-5 in basis2).  rows[s] has
+// every combination whose basis1 bit is in s.
+struct CombinationTables {
+  uint64_t implied[6][6][6][8];
+  uint64_t rows[256];
+
+  CombinationTables() : implied(), rows() {
+    for (int a = 0; a < 8; a++) {
+      for (int b = 0; b < 8; b++) {
+	const uint8_t *first = basis_to_pair_and_term_clear_masks[1 << a];
+	const uint8_t *second = basis_to_pair_and_term_clear_masks[1 << b];
+	uint8_t joint_states[6] = {
+	  first[3], first[4], first[5], second[3], second[4], second[5]
+	};
+	uint64_t combination = 1ULL << (a * 8 + b);
+	for (int o1 = 0; o1 < 6; o1++) {
+	  for (int o2 = 0; o2 < 6; o2++) {
+	    for (int o3 = 0; o3 < 6; o3++) {
+	      uint8_t proposal =
+		threed_intermediary_set_masks
+		[joint_states[o1]][joint_states[o2]][joint_states[o3]];
+	      for (int v = 0; v < 8; v++) {
+		if (proposal & (1 << v)) {
+		  implied[o1][o2][o3][v] |= combination;
+		}
+	      }
+	    }
+	  }
 	}
       }
     }
+    for (int s = 0; s < 256; s++) {
+      for (int a = 0; a < 8; a++) {
+	if (s & (1 << a)) {
+	  rows[s] |= 0xFFULL << (a * 8);
+	}
+      }
+    }
+  }
+};
+
+static const CombinationTables& combination_tables() {
+  static const CombinationTables tables;
+  return tables;
+}
+
+// same result as combine_bases_scalar with all 64 combinations held as
+// the bits of one word, so each intermediary filters every combination
+// with a handful of ANDs and ORs
+template <size_t P>
+static void combine_bases_bitsliced(uint8_t basis1_state,
+				    uint8_t basis2_state,
+				    const uint8_t* inter_states,
+				    uint8_t* new_inter_states,
+				    uint8_t& new_basis1_state,
+				    uint8_t& new_basis2_state) {
+  constexpr const MergePattern& pattern = merge_pattern_tables.patterns[P];
+  constexpr size_t num_intermediaries = pattern.num_intermediaries;
+  const CombinationTables& tables = combination_tables();
+  uint64_t combinations = tables.rows[basis1_state] &
+    (basis2_state * 0x0101010101010101ULL);
+  const uint64_t* implied[num_intermediaries];
+  for (size_t i = 0; i < num_intermediaries; i++) {
+    implied[i] = tables.implied
+      [pattern.offsets[i][0]][pattern.offsets[i][1]][pattern.offsets[i][2]];
+    uint64_t allowed = 0;
+    for (uint8_t bits = inter_states[i]; bits; bits &= bits - 1) {
+      allowed |= implied[i][__builtin_ctz(bits)];
+    }
+    combinations &= allowed;
+  }
+  if (!combinations) {
+    return;
+  }
+  for (int a = 0; a < 8; a++) {
+    if ((combinations >> (a * 8)) & 0xFF) {
+      new_basis1_state |= 1 << a;
+    }
+  }
+  uint64_t columns = combinations;
+  columns |= columns >> 32;
+  columns |= columns >> 16;
+  columns |= columns >> 8;
+  new_basis2_state |= columns & 0xFF;
+  for (size_t i = 0; i < num_intermediaries; i++) {
+    for (int v = 0; v < 8; v++) {
+      if (combinations & implied[i][v]) {
+	new_inter_states[i] |= 1 << v;
+      }
+    }
+  }
+}
+
+// Per thread direct mapped cache of combination outcomes.  a key is
+// the pattern (plus one so zeroed slots never match), the two basis
+// states and the intermediary states, zero padded to three words; the
+// value is the new basis and intermediary states in the same order.
+struct CombineCacheEntry {
+  uint64_t key[3];
+  uint8_t value[2 + MAX_INTERMEDIARY_BASES];
+};
+
+// only the owning thread counts, with a relaxed load and store
+// rather than a locked add, so combine_cache_stats can read the
+// counts from another thread without a data race
+struct CombineCache {
+  std::vector<CombineCacheEntry> entries;
+  std::atomic<uint64_t> lookups{0};
+  std::atomic<uint64_t> hits{0};
+};
+
+static inline void count_combine(std::atomic<uint64_t>& counter) {
+  counter.store(counter.load(std::memory_order_relaxed) + 1,
+		std::memory_order_relaxed);
+}
+
+static std::atomic<size_t> combine_cache_entries(0);
+// every thread's cache, so the stats outlive pool threads' lookups
+static std::mutex combine_cache_mutex;
+static std::vector<std::shared_ptr<CombineCache>> combine_caches;
+
+void set_combine_cache(size_t entries) {
+  size_t rounded = entries ? 1 : 0;
+  while (rounded && rounded < entries) {
+    rounded <<= 1;
+  }
+  combine_cache_entries.store(rounded, std::memory_order_relaxed);
+}
+
+size_t combine_cache_bytes() {
+  return combine_cache_entries.load(std::memory_order_relaxed) *
+    sizeof(CombineCacheEntry);
+}
+
+CombineCacheStats combine_cache_stats() {
+  std::lock_guard<std::mutex> lock(combine_cache_mutex);
+  CombineCacheStats stats = {0, 0};
+  for (const auto& cache : combine_caches) {
+    stats.lookups += cache->lookups.load(std::memory_order_relaxed);
+    stats.hits += cache->hits.load(std::memory_order_relaxed);
+  }
+  return stats;
+}
+
+void reset_combine_cache_stats() {
+  std::lock_guard<std::mutex> lock(combine_cache_mutex);
+  for (const auto& cache : combine_caches) {
+    cache->lookups.store(0, std::memory_order_relaxed);
+    cache->hits.store(0, std::memory_order_relaxed);
+  }
+}
+
+// This thread's cache, (re)sized to the current setting.  null when
+// caching is off.  the engines fetch it once per sweep and hand it
+// to every combination of the sweep.
+static CombineCache* thread_combine_cache() {
+  thread_local std::shared_ptr<CombineCache> cache;
+  size_t entries = combine_cache_entries.load(std::memory_order_relaxed);
+  if (!entries) {
+    return nullptr;
+  }
+  if (!cache) {
+    cache = std::make_shared<CombineCache>();
+    std::lock_guard<std::mutex> lock(combine_cache_mutex);
+    combine_caches.push_back(cache);
+  }
+  if (cache->entries.size() != entries) {
+    cache->entries.assign(entries, CombineCacheEntry());
+  }
+  return cache.get();
+}
+
+// Run the active combination kernel for pattern P, through cache, the
+// calling thread's cache, when there is one
+template <size_t P>
+static inline void combine_bases(CombineCache* cache,
+				 uint8_t basis1_state,
+				 uint8_t basis2_state,
+				 const uint8_t* inter_states,
+				 uint8_t* new_inter_states,
+				 uint8_t& new_basis1_state,
+				 uint8_t& new_basis2_state) {
+  constexpr size_t num_intermediaries =
+    merge_pattern_tables.patterns[P].num_intermediaries;
+  uint64_t key[3] = {0, 0, 0};
+  CombineCacheEntry* entry = nullptr;
+  if (cache) {
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(key);
+    bytes[0] = P + 1;
+    bytes[1] = basis1_state;
+    bytes[2] = basis2_state;
+    std::memcpy(bytes + 3, inter_states, num_intermediaries);
+    uint64_t hash = (key[0] ^ (key[1] * 0x9E3779B97F4A7C15ULL) ^
+		     (key[2] * 0xC2B2AE3D27D4EB4FULL)) * 0xFF51AFD7ED558CCDULL;
+    entry = &cache->entries[(hash >> 32) & (cache->entries.size() - 1)];
+    count_combine(cache->lookups);
+    if (entry->key[0] == key[0] && entry->key[1] == key[1] &&
+	entry->key[2] == key[2]) {
+      count_combine(cache->hits);
+      new_basis1_state = entry->value[0];
+      new_basis2_state = entry->value[1];
+      std::memcpy(new_inter_states, entry->value + 2, num_intermediaries);
+      return;
+    }
+  }
+  if (active_basis_kernel == BasisKernel::SCALAR) {
+    combine_bases_scalar<P>(basis1_state, basis2_state,
+			    inter_states, new_inter_states,
+			    new_basis1_state, new_basis2_state);
+  } else {
+    combine_bases_bitsliced<P>(basis1_state, basis2_state,
+			       inter_states, new_inter_states,
+			       new_basis1_state, new_basis2_state);
+  }
+  if (entry) {
+    std::memcpy(entry->key, key, sizeof(key));
+    entry->value[0] = new_basis1_state;
+    entry->value[1] = new_basis2_state;
+    std::memcpy(entry->value + 2, new_inter_states, num_intermediaries);
+  }
+}
+
+// Terms, triangular numbers and basis indices of the intermediaries of
+// bp, which interleaves as pattern P.  pair2d(a, b) is tri[b] + a and
+// pair3d(a, b, c) is tet[c] + tri[b] + a, so each term needs its
+// triangular numbers once; most fall out of the hoisted pair and
+// basis indices.
+template <size_t P>
+static inline void intermediary_indices(const BasisPair& bp,
+					Index* term,
+					Index* tri,
+					Index* inter_idx) {
+  constexpr const MergePattern& pattern = merge_pattern_tables.patterns[P];
+  constexpr size_t num_intermediaries = pattern.num_intermediaries;
+  const Index i1 = bp.i1, j1 = bp.j1, k1 = bp.k1;
+  const Index i2 = bp.i2, j2 = bp.j2, k2 = bp.k2;
+  term[0] = i1; term[1] = j1; term[2] = k1;
+  term[3] = i2; term[4] = j2; term[5] = k2;
+  tri[0] = (i1 * (i1 - 1)) / 2;
+  tri[1] = bp.ij1_idx - i1;
+  tri[2] = bp.ik1_idx - i1;
+  tri[3] = (i2 * (i2 - 1)) / 2;
+  tri[4] = bp.ij2_idx - i2;
+  tri[5] = bp.ik2_idx - i2;
+  const Index tet[6] = {(i1 * (i1 - 1) * (i1 - 2)) / 6,
+			(j1 * (j1 - 1) * (j1 - 2)) / 6,
+			bp.basis1_idx - bp.ij1_idx,
+			(i2 * (i2 - 1) * (i2 - 2)) / 6,
+			(j2 * (j2 - 1) * (j2 - 2)) / 6,
+			bp.basis2_idx - bp.ij2_idx};
+  for (size_t idx = 0; idx < num_intermediaries; idx++) {
+    inter_idx[idx] = tet[pattern.offsets[idx][2]] +
+      tri[pattern.offsets[idx][1]] + term[pattern.offsets[idx][0]];
+  }
+}
+
+// ensure_basis_consistency for one interleaving P of the two bases.
+// the number of intermediaries, their terms and their offsets into
+// joint_states are compile time constants so the loops over the
+// intermediaries unroll and the offset lookups fold away.
+//
+// Intermediary bases are composed of one term from one basis and two
+// terms from the other.  the key insight is that by constraining the
+// intermediary bases, we ensure consistency between basis1 and
+// basis2, since any valid assignment to both bases must also be
+// valid on every intermediary.
+template <bool Shared, size_t P,
+	  typename TermStates = std::vector<uint8_t>,
+	  typename PairStates = TermStates,
+	  typename BasisStates = TermStates>
+static UpdateResult ensure_basis_consistency_pattern
+(const BasisPair& bp,
+ TermStates& term_states,
+ PairStates& pair_states,
+ BasisStates& basis_states,
+ CombineCache* cache) {
+  constexpr const MergePattern& pattern = merge_pattern_tables.patterns[P];
+  constexpr size_t num_intermediaries = pattern.num_intermediaries;
+  const Index i1 = bp.i1, j1 = bp.j1, k1 = bp.k1;
+  const Index i2 = bp.i2, j2 = bp.j2, k2 = bp.k2;
+  const Index basis1_idx = bp.basis1_idx;
+  const Index basis2_idx = bp.basis2_idx;
+  // pair indices come hoisted from the caller
+  const Index ij1_idx = bp.ij1_idx;
+  const Index ik1_idx = bp.ik1_idx;
+  const Index jk1_idx = bp.jk1_idx;
+  const Index ij2_idx = bp.ij2_idx;
+  const Index ik2_idx = bp.ik2_idx;
+  const Index jk2_idx = bp.jk2_idx;
+
+  // First update each basis individually
+  UpdateResult result =
+    update_basis_states_impl<Shared>(i1, j1, k1,
+				     ij1_idx, ik1_idx, jk1_idx,
+				     basis1_idx,
+				     term_states,
+				     pair_states,
+				     basis_states);
+  
+  if(result.has_zero) {
+    return result;
+  }
+  // make basis2 consistent with basis1
+  UpdateResult basis2_result =
+    update_basis_states_impl<Shared>(i2, j2, k2,
+				     ij2_idx, ik2_idx, jk2_idx,
+				     basis2_idx,
+				     term_states,
+				     pair_states,
+				     basis_states);
+  if(basis2_result.has_zero) {
+    return basis2_result;
+  }
+  result.changed = result.changed || basis2_result.changed;
+
+  // make basis1 consistent with basis2
+  UpdateResult basis1_result =
+    update_basis_states_impl<Shared>(i1, j1, k1,
+				     ij1_idx, ik1_idx, jk1_idx,
+				     basis1_idx,
+				     term_states,
+				     pair_states,
+				     basis_states);
+  if(basis1_result.has_zero) {
+    return basis1_result;
+  }
+  result.changed = result.changed || basis1_result.changed;
+    
+  // Indices of the intermediaries
+  Index term[6], tri[6];
+  Index inter_idx[num_intermediaries];
+  intermediary_indices<P>(bp, term, tri, inter_idx);
+    
+  // Update all intermediary bases
+  bool any_changed;
+  do {
+    any_changed = false;
+    for (size_t idx = 0; idx < num_intermediaries; idx++) {
+      const size_t oa = pattern.offsets[idx][0];
+      const size_t ob = pattern.offsets[idx][1];
+      const size_t oc = pattern.offsets[idx][2];
+      UpdateResult inter_result =
+	update_basis_states_impl<Shared>(term[oa], term[ob], term[oc],
+					 tri[ob] + term[oa],
+					 tri[oc] + term[oa],
+					 tri[oc] + term[ob],
+					 inter_idx[idx],
+					 term_states,
+					 pair_states,
+					 basis_states);
+      if (inter_result.has_zero) {
+	return inter_result;
+      }
+      any_changed |= inter_result.changed;
+    }
+    result.changed = result.changed || any_changed;
+  } while (any_changed);
+  // Calculate consistent states
+  uint8_t basis1_state = load_state<Shared>(basis_states[basis1_idx]);
+  uint8_t basis2_state = load_state<Shared>(basis_states[basis2_idx]);
+  uint8_t inter_states[num_intermediaries];
+  uint8_t new_inter_states[num_intermediaries] = {0};
+  for (size_t i = 0; i < num_intermediaries; i++) {
+    inter_states[i] = load_state<Shared>(basis_states[inter_idx[i]]);
   }
+    
+  uint8_t new_basis1_state = 0;
+  uint8_t new_basis2_state = 0;
+  combine_bases<P>(cache, basis1_state, basis2_state,
+		   inter_states, new_inter_states,
+		   new_basis1_state, new_basis2_state);
 
   // Update basis1 if changed
   if(basis1_state != new_basis1_state) {
-    basis1_state = new_basis1_state;
+    and_state<Shared>(basis_states[basis1_idx], new_basis1_state);
     result.changed = true;
         
     // Update pairs and terms using pre-computed indices
     const uint8_t *bpt_clear_masks =
       basis_to_pair_and_term_clear_masks[new_basis1_state];
 
-    pair_states[ij1_idx] &= bpt_clear_masks[0];
-    pair_states[ik1_idx] &= bpt_clear_masks[1];
-    pair_states[jk1_idx] &= bpt_clear_masks[2];
-    term_states[i1] &= bpt_clear_masks[3];
-    term_states[j1] &= bpt_clear_masks[4];
-    term_states[k1] &= bpt_clear_masks[5];
+    and_state<Shared>(pair_states[ij1_idx], bpt_clear_masks[0]);
+    and_state<Shared>(pair_states[ik1_idx], bpt_clear_masks[1]);
+    and_state<Shared>(pair_states[jk1_idx], bpt_clear_masks[2]);
+    and_state<Shared>(term_states[i1], bpt_clear_masks[3]);
+    and_state<Shared>(term_states[j1], bpt_clear_masks[4]);
+    and_state<Shared>(term_states[k1], bpt_clear_masks[5]);
 
     // Check for contradictions
     if((!new_basis1_state) ||
-       (!pair_states[ij1_idx]) ||
-       (!pair_states[ik1_idx]) ||
-       (!pair_states[jk1_idx]) ||
-       (!term_states[i1]) ||
-       (!term_states[j1]) ||
-       (!term_states[k1])) {
+       (!load_state<Shared>(pair_states[ij1_idx])) ||
+       (!load_state<Shared>(pair_states[ik1_idx])) ||
+       (!load_state<Shared>(pair_states[jk1_idx])) ||
+       (!load_state<Shared>(term_states[i1])) ||
+       (!load_state<Shared>(term_states[j1])) ||
+       (!load_state<Shared>(term_states[k1]))) {
       result.has_zero = true;
       return result;
     }
@@ -1169,27 +1599,27 @@ UpdateResult ensure_basis_consistency
 
   // Update basis2 if changed
   if(basis2_state != new_basis2_state) {
-    basis2_state = new_basis2_state;
+    and_state<Shared>(basis_states[basis2_idx], new_basis2_state);
     result.changed = true;
         
     const uint8_t *bpt_clear_masks =
       basis_to_pair_and_term_clear_masks[new_basis2_state];
 
-    pair_states[ij2_idx] &= bpt_clear_masks[0];
-    pair_states[ik2_idx] &= bpt_clear_masks[1];
-    pair_states[jk2_idx] &= bpt_clear_masks[2];
-    term_states[i2] &= bpt_clear_masks[3];
-    term_states[j2] &= bpt_clear_masks[4];
-    term_states[k2] &= bpt_clear_masks[5];
+    and_state<Shared>(pair_states[ij2_idx], bpt_clear_masks[0]);
+    and_state<Shared>(pair_states[ik2_idx], bpt_clear_masks[1]);
+    and_state<Shared>(pair_states[jk2_idx], bpt_clear_masks[2]);
+    and_state<Shared>(term_states[i2], bpt_clear_masks[3]);
+    and_state<Shared>(term_states[j2], bpt_clear_masks[4]);
+    and_state<Shared>(term_states[k2], bpt_clear_masks[5]);
 
     // Check for contradictions
     if((!new_basis2_state) ||
-       (!pair_states[ij2_idx]) ||
-       (!pair_states[ik2_idx]) ||
-       (!pair_states[jk2_idx]) ||
-       (!term_states[i2]) ||
-       (!term_states[j2]) ||
-       (!term_states[k2])) {
+       (!load_state<Shared>(pair_states[ij2_idx])) ||
+       (!load_state<Shared>(pair_states[ik2_idx])) ||
+       (!load_state<Shared>(pair_states[jk2_idx])) ||
+       (!load_state<Shared>(term_states[i2])) ||
+       (!load_state<Shared>(term_states[j2])) ||
+       (!load_state<Shared>(term_states[k2]))) {
       result.has_zero = true;
       return result;
     }
@@ -1197,12 +1627,67 @@ UpdateResult ensure_basis_consistency
 
   // Update intermediary basis states
   for(size_t i = 0; i < num_intermediaries; i++) {
-    basis_states[intermediaries[i].basis_idx] = intermediaries[i].state;
+    if(inter_states[i] & ~new_inter_states[i]) {
+      and_state<Shared>(basis_states[inter_idx[i]], new_inter_states[i]);
+      result.changed = true;
+    }
   }
     
   return result;
 }
 
+template <bool Shared, typename TermStates = std::vector<uint8_t>,
+	  typename PairStates = TermStates,
+	  typename BasisStates = TermStates>
+using PatternKernel = UpdateResult (*)(const BasisPair&,
+				       TermStates&, PairStates&,
+				       BasisStates&, CombineCache*);
+
+template <bool Shared, typename TermStates, typename PairStates,
+	  typename BasisStates, size_t... P>
+static constexpr std::array<PatternKernel<Shared, TermStates, PairStates,
+					  BasisStates>,
+			    sizeof...(P)>
+make_pattern_kernels(std::index_sequence<P...>) {
+  return {{ &ensure_basis_consistency_pattern<Shared, P, TermStates,
+					      PairStates, BasisStates>... }};
+}
+
+// one specialization of ensure_basis_consistency per interleaving
+template <bool Shared, typename TermStates = std::vector<uint8_t>,
+	  typename PairStates = TermStates,
+	  typename BasisStates = TermStates>
+static constexpr std::array<PatternKernel<Shared, TermStates, PairStates,
+					  BasisStates>,
+			    NUM_MERGE_PATTERNS>
+pattern_kernels =
+  make_pattern_kernels<Shared, TermStates, PairStates, BasisStates>
+  (std::make_index_sequence<NUM_MERGE_PATTERNS>());
+
+template <bool Shared, typename TermStates, typename PairStates,
+	  typename BasisStates>
+static UpdateResult ensure_basis_consistency_impl
+(const BasisPair& bp,
+ TermStates& term_states,
+ PairStates& pair_states,
+ BasisStates& basis_states,
+ CombineCache* cache) {
+  return pattern_kernels<Shared, TermStates, PairStates, BasisStates>
+    [classify_basis_pair(bp)](bp, term_states, pair_states, basis_states,
+			      cache);
+}
+
+UpdateResult ensure_basis_consistency(const BasisPair& bp,
+				      std::vector<uint8_t>& term_states,
+				      std::vector<uint8_t>& pair_states,
+				      std::vector<uint8_t>& basis_states) {
+  return ensure_basis_consistency_impl<false>(bp,
+					      term_states,
+					      pair_states,
+					      basis_states,
+					      thread_combine_cache());
+}
+
 void dump_term_states(std::vector<uint8_t> &term_states) {
   for(Index term = 0; term < term_states.size(); ++term) {
     std::cout << "term " << term << " "
@@ -1219,71 +1704,1086 @@ void dump_pair_states(std::vector<uint8_t> &pair_states) {
   }
 }
 
-bool ensure_global_consistency(std::vector<uint8_t>& term_states,
-			       std::vector<uint8_t>& pair_states,
-			       std::vector<uint8_t>& basis_states,
-			       bool& has_contradiction,
-			       Index starting_basis_pair,
-			       Index ending_basis_pair) {
-  has_contradiction = false;
-  bool changed = true;
-  bool globally_changed = false;
-  while (changed) {
-    changed = false;
-    for(Index basis_pair = starting_basis_pair;
-	basis_pair < ending_basis_pair;
-	++basis_pair) {
-      Index basis1_idx,basis2_idx;
-      std::tie(basis1_idx,basis2_idx) = unpair2d(basis_pair);
-      Index i1,j1,k1,i2,j2,k2;
-      std::tie(i1,j1,k1) = unpair3d(basis1_idx);
-      std::tie(i2,j2,k2) = unpair3d(basis2_idx);
-      auto result =
-	ensure_basis_consistency(i1, j1, k1, i2, j2, k2,
-				 basis1_idx,
-				 basis2_idx,
-				 term_states,
-				 pair_states,
-				 basis_states);
-      if (result.has_zero) {
-	has_contradiction = true;
-	return true;
-      }
-                        
-      if (result.changed) {
-	changed = true;
-	globally_changed = true;
-      }
-    }
+// Stop requests from a deadline or an interrupt are global so a
+// signal handler can raise them.  the deadline is stored as a
+// steady_clock tick count, 0 meaning none.
+static std::atomic<int> stop_reason(static_cast<int>(StopReason::NONE));
+static std::atomic<int64_t> stop_deadline(0);
+
+// Sweeps check for a stop request once every STOP_POLL_INTERVAL
+// basis pairs
+static const Index STOP_POLL_INTERVAL = 4096;
+
+void arm_engine_deadline(uint64_t timeout_ms) {
+  int deadline = static_cast<int>(StopReason::DEADLINE);
+  stop_reason.compare_exchange_strong(deadline,
+				      static_cast<int>(StopReason::NONE));
+  if(timeout_ms == 0) {
+    stop_deadline.store(0);
+    return;
   }
-  return globally_changed;
+  auto deadline_time = std::chrono::steady_clock::now() +
+    std::chrono::milliseconds(timeout_ms);
+  stop_deadline.store(deadline_time.time_since_epoch().count());
 }
 
-// Structure to hold work segment boundaries
-struct WorkSegment {
-  Index starting_basis_pair;
-  Index ending_basis_pair;
-};
-
-// Structure to hold worker results
-struct WorkerResult {
-  Index updates;
-  bool has_contradiction;
-  bool has_changed;
-  std::vector<uint8_t> term_states;
-  std::vector<uint8_t> pair_states;
-  std::vector<uint8_t> basis_states;
-};
+void request_engine_stop(StopReason reason) {
+  // the first reason wins
+  int none = static_cast<int>(StopReason::NONE);
+  stop_reason.compare_exchange_strong(none, static_cast<int>(reason));
+}
 
-// Function to divide work among workers
-std::vector<WorkSegment> divide_work(Index n, int num_workers) {
-  std::vector<WorkSegment> segments;
+StopReason engine_stop_reason() {
+  return static_cast<StopReason>(stop_reason.load());
+}
 
-  Index num_basis_pairs =
-    calculate_array_size_2d(calculate_array_size_3d(n));
-  Index basis_pairs_per_worker = num_basis_pairs / num_workers;
+// true once the current run should give up: either another worker of
+// the same run found a contradiction and raised cancel, or the engine
+// was asked to stop globally.  cancel may be null for sequential runs.
+static bool engine_should_stop(const std::atomic<bool>* cancel) {
+  if(cancel && cancel->load(std::memory_order_relaxed)) {
+    return true;
+  }
+  if(stop_reason.load(std::memory_order_relaxed) !=
+     static_cast<int>(StopReason::NONE)) {
+    return true;
+  }
+  int64_t deadline = stop_deadline.load(std::memory_order_relaxed);
+  if(deadline != 0 &&
+     std::chrono::steady_clock::now().time_since_epoch().count() >=
+     deadline) {
+    request_engine_stop(StopReason::DEADLINE);
+    return true;
+  }
+  return false;
+}
+
+// Tell the other workers of this run that a contradiction was found
+static void cancel_run(std::atomic<bool>* cancel) {
+  if(cancel) {
+    cancel->store(true, std::memory_order_relaxed);
+  }
+}
+
+// One mark per state of a level, for the worklist engine.  a byte
+// rather than a bit, so the kernel marks a write with a plain store.
+class StateMarks {
+public:
+  void reset(Index size) { marks_.assign(size, 0); }
+  void clear() { std::fill(marks_.begin(), marks_.end(), 0); }
+  void swap(StateMarks& other) { marks_.swap(other.marks_); }
+
+  bool test(Index idx) const { return marks_[idx]; }
+  uint8_t* data() { return marks_.data(); }
+
+  bool any() const {
+    return std::find(marks_.begin(), marks_.end(), 1) != marks_.end();
+  }
+  Index count() const {
+    return std::count(marks_.begin(), marks_.end(), 1);
+  }
+
+  // visit(idx) for every marked state in increasing order, until
+  // visit returns false.  returns false if it stopped early.
+  template <typename Visit>
+  bool for_each(Visit visit) const {
+    for(Index idx = 0; idx < marks_.size(); ++idx) {
+      if(marks_[idx] && !visit(idx)) {
+	return false;
+      }
+    }
+    return true;
+  }
+
+private:
+  std::vector<uint8_t> marks_;
+};
+
+// The states of every level a pass of the worklist engine narrowed
+struct ChangedStates {
+  StateMarks terms;
+  StateMarks pairs;
+  StateMarks bases;
+
+  void reset(Index num_terms) {
+    terms.reset(num_terms);
+    pairs.reset(calculate_array_size_2d(num_terms));
+    bases.reset(calculate_array_size_3d(num_terms));
+  }
+  void clear() {
+    terms.clear();
+    pairs.clear();
+    bases.clear();
+  }
+  void swap(ChangedStates& other) {
+    terms.swap(other.terms);
+    pairs.swap(other.pairs);
+    bases.swap(other.bases);
+  }
+  bool any() const { return terms.any() || pairs.any() || bases.any(); }
+};
+
+// A byte level whose writes mark every state they narrow, so the
+// worklist engine learns what changed from the kernel itself rather
+// than by diffing snapshots.  reads go straight to the bytes, writes
+// also count into writes.  holds plain pointers: every state store is
+// a char store that may alias anything, and a pointer is one reload
+// less than a vector.
+class TrackedStates {
+public:
+  class Ref {
+  public:
+    Ref(uint8_t* state, uint8_t* mark, Index* writes)
+      : state_(state), mark_(mark), writes_(writes) {}
+
+    operator uint8_t() const { return *state_; }
+
+    Ref& operator&=(uint8_t mask) {
+      if(*state_ & ~mask) {
+	*state_ &= mask;
+	*mark_ = 1;
+	++*writes_;
+      }
+      return *this;
+    }
+
+  private:
+    uint8_t* state_;
+    uint8_t* mark_;
+    Index* writes_;
+  };
+
+  TrackedStates(std::vector<uint8_t>& states, StateMarks& changed,
+		Index& writes)
+    : states_(states.data()), marks_(changed.data()), writes_(&writes),
+      size_(states.size()) {}
+
+  Index size() const { return size_; }
+  uint8_t operator[](Index idx) const { return states_[idx]; }
+  Ref operator[](Index idx) {
+    return Ref(states_ + idx, marks_ + idx, writes_);
+  }
+
+private:
+  uint8_t* states_;
+  uint8_t* marks_;
+  Index* writes_;
+  Index size_;
+};
+
+// A state named by its level (0 terms, 1 pairs, 2 bases) and index
+typedef std::pair<int, Index> StateKey;
+
+// ensure_basis_consistency on a basis pair reads and writes only the
+// states among its (up to 6) terms: the terms, the pairs between
+// them and the 20 bases they form.  of those that are dirty, the
+// first in a fixed order over the sorted terms owns the pair, so a
+// pair covered by several dirty states is still visited once.
+static StateKey first_dirty_state(const BasisPair& bp,
+				  const ChangedStates& dirty) {
+  Index terms[6] = {bp.i1, bp.j1, bp.k1, bp.i2, bp.j2, bp.k2};
+  std::sort(terms, terms + 6);
+  size_t count = std::unique(terms, terms + 6) - terms;
+  for(size_t a = 0; a < count; ++a) {
+    if(dirty.terms.test(terms[a])) {
+      return StateKey(0, terms[a]);
+    }
+  }
+  for(size_t b = 1; b < count; ++b) {
+    for(size_t a = 0; a < b; ++a) {
+      Index idx = pair2d(terms[a], terms[b]);
+      if(dirty.pairs.test(idx)) {
+	return StateKey(1, idx);
+      }
+    }
+  }
+  for(size_t c = 2; c < count; ++c) {
+    for(size_t b = 1; b < c; ++b) {
+      for(size_t a = 0; a < b; ++a) {
+	Index idx = pair3d(terms[a], terms[b], terms[c]);
+	if(dirty.bases.test(idx)) {
+	  return StateKey(2, idx);
+	}
+      }
+    }
+  }
+  return StateKey(-1, 0);
+}
+
+// visit(i, j, k) for every basis of n terms that contains the count
+// (0 to 3) sorted terms, until visit returns false.  the free terms
+// are enumerated directly, so this takes O(n^(3 - count)).
+template <typename Visit>
+static bool for_each_basis_with(const Index* terms, size_t count,
+				Index n, Visit visit) {
+  if(count == 3) {
+    return visit(terms[0], terms[1], terms[2]);
+  }
+  if(count == 2) {
+    const Index a = terms[0], b = terms[1];
+    for(Index z = 0; z < n; ++z) {
+      if(z == a || z == b) {
+	continue;
+      }
+      bool more = (z < a) ? visit(z, a, b) :
+	(z < b) ? visit(a, z, b) : visit(a, b, z);
+      if(!more) {
+	return false;
+      }
+    }
+    return true;
+  }
+  if(count == 1) {
+    const Index t = terms[0];
+    for(Index z = 1; z < n; ++z) {
+      if(z == t) {
+	continue;
+      }
+      for(Index y = 0; y < z; ++y) {
+	if(y == t) {
+	  continue;
+	}
+	bool more = (t < y) ? visit(t, y, z) :
+	  (t < z) ? visit(y, t, z) : visit(y, z, t);
+	if(!more) {
+	  return false;
+	}
+      }
+    }
+    return true;
+  }
+  for(Index k = 2; k < n; ++k) {
+    for(Index j = 1; j < k; ++j) {
+      for(Index i = 0; i < j; ++i) {
+	if(!visit(i, j, k)) {
+	  return false;
+	}
+      }
+    }
+  }
+  return true;
+}
+
+// Number of basis1, basis2 combinations visit_basis_pairs_covering
+// walks for a dirty state of count terms, each basis pair twice.
+// kept in floating point, it overflows a 32 bit Index early.
+static double covering_candidates(size_t count, Index n) {
+  auto choose = [](double m, size_t r) {
+    double c = 1;
+    for(size_t x = 0; x < r; ++x) {
+      c = c * (m - x) / (x + 1);
+    }
+    return c < 0 ? 0 : c;
+  };
+  double candidates = 0;
+  for(size_t in1 = 0; in1 <= count; ++in1) {
+    // basis1 holds in1 of the terms and misses the others, basis2
+    // holds the count - in1 terms basis1 misses
+    candidates += choose(count, in1) *
+      choose(double(n) - count, 3 - in1) *
+      choose(double(n) - (count - in1), 3 - (count - in1));
+  }
+  return candidates;
+}
+
+// visit(bp) for every basis pair in [starting_basis_pair,
+// ending_basis_pair) whose terms include the count sorted terms of
+// the dirty state key and which key owns (see first_dirty_state).
+// basis1 is built from the terms of the state it holds and basis2
+// from the ones basis1 lacks, so a dirty basis costs O(n^3), a pair
+// O(n^4) and a term O(n^5), against the O(n^6) of a full pass.
+template <typename Visit>
+static bool visit_basis_pairs_covering(const Index* terms, size_t count,
+				       const StateKey& key,
+				       Index n,
+				       const ChangedStates& dirty,
+				       Index starting_basis_pair,
+				       Index ending_basis_pair,
+				       Visit visit) {
+  BasisPair bp;
+  for(unsigned held = 0; held < (1u << count); ++held) {
+    Index in1[3], in2[3];
+    size_t count1 = 0, count2 = 0;
+    for(size_t t = 0; t < count; ++t) {
+      if(held & (1u << t)) {
+	in1[count1++] = terms[t];
+      } else {
+	in2[count2++] = terms[t];
+      }
+    }
+    auto visit_basis1 = [&](Index i1, Index j1, Index k1) {
+      // basis1 holds exactly the terms of in1, so every basis pair
+      // comes up under one subset only
+      for(size_t t = 0; t < count2; ++t) {
+	if(in2[t] == i1 || in2[t] == j1 || in2[t] == k1) {
+	  return true;
+	}
+      }
+      const Index basis1_idx = pair3d(i1, j1, k1);
+      return for_each_basis_with(in2, count2, n,
+				 [&](Index i2, Index j2, Index k2) {
+	Index basis2_idx = pair3d(i2, j2, k2);
+	// the swapped pair comes up with basis1 and basis2 reversed
+	if(basis2_idx <= basis1_idx) {
+	  return true;
+	}
+	Index basis_pair = pair2d(basis1_idx, basis2_idx);
+	if(basis_pair < starting_basis_pair ||
+	   basis_pair >= ending_basis_pair) {
+	  return true;
+	}
+	bp.basis1_idx = basis1_idx;
+	bp.basis2_idx = basis2_idx;
+	bp.i1 = i1; bp.j1 = j1; bp.k1 = k1;
+	bp.i2 = i2; bp.j2 = j2; bp.k2 = k2;
+	if(first_dirty_state(bp, dirty) != key) {
+	  return true;
+	}
+	bp.ij1_idx = pair2d(i1, j1);
+	bp.ik1_idx = pair2d(i1, k1);
+	bp.jk1_idx = pair2d(j1, k1);
+	bp.ij2_idx = pair2d(i2, j2);
+	bp.ik2_idx = pair2d(i2, k2);
+	bp.jk2_idx = pair2d(j2, k2);
+	return visit(static_cast<const BasisPair&>(bp));
+      });
+    };
+    if(!for_each_basis_with(in1, count1, n, visit_basis1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// visit(bp) once for every basis pair in the range that reads a
+// state dirty marks, until visit returns false
+template <typename Visit>
+static bool visit_dirty_basis_pairs(const ChangedStates& dirty,
+				    Index n,
+				    Index starting_basis_pair,
+				    Index ending_basis_pair,
+				    Visit visit) {
+  auto covering = [&](const Index* terms, size_t count,
+		      const StateKey& key) {
+    return visit_basis_pairs_covering(terms, count, key, n, dirty,
+				      starting_basis_pair,
+				      ending_basis_pair, visit);
+  };
+  return dirty.terms.for_each([&](Index idx) {
+      Index terms[1] = {idx};
+      return covering(terms, 1, StateKey(0, idx));
+    }) &&
+    dirty.pairs.for_each([&](Index idx) {
+	Index terms[2];
+	std::tie(terms[0], terms[1]) = unpair2d(idx);
+	return covering(terms, 2, StateKey(1, idx));
+      }) &&
+    dirty.bases.for_each([&](Index idx) {
+	Index terms[3];
+	std::tie(terms[0], terms[1], terms[2]) = unpair3d(idx);
+	return covering(terms, 3, StateKey(2, idx));
+      });
+}
+
+// true when walking the basis pairs of every dirty state would look
+// at more candidates than a full pass over the range visits pairs.
+// each dirty state is walked on its own, so a pass that narrowed
+// much is cheaper to redo in full.
+static bool dirty_walk_exceeds_pass(const ChangedStates& dirty, Index n,
+				    Index starting_basis_pair,
+				    Index ending_basis_pair) {
+  double pass = double(ending_basis_pair - starting_basis_pair);
+  double walk = dirty.terms.count() * covering_candidates(1, n) +
+    dirty.pairs.count() * covering_candidates(2, n) +
+    dirty.bases.count() * covering_candidates(3, n);
+  return walk >= pass;
+}
+
+// Which parts of the state space can still prune anything.  a term is
+// constrained once a term, pair or basis it belongs to has lost a
+// bit, and a basis is constrained once one of its terms is.  when
+// neither basis of a pair is constrained every state
+// ensure_basis_consistency would look at is still SET_ANY, so the
+// pair can be skipped without changing the result.  states only lose
+// bits so the summaries only ever grow.
+struct ConstrainedSummary {
+  std::vector<uint8_t> terms;
+  std::vector<uint8_t> bases;
+  Index visited = 0;
+  Index skipped = 0;
+};
+
+// mark term and every basis containing it as constrained
+static void mark_term_constrained(Index term, ConstrainedSummary& summary) {
+  if(summary.terms[term]) {
+    return;
+  }
+  summary.terms[term] = 1;
+  Index n = summary.terms.size();
+  for(Index b = 1; b < n; ++b) {
+    for(Index a = 0; a < b; ++a) {
+      if(a == term || b == term) {
+	continue;
+      }
+      Index basis_idx = (term < a) ? pair3d(term, a, b) :
+	((term < b) ? pair3d(a, term, b) : pair3d(a, b, term));
+      summary.bases[basis_idx] = 1;
+    }
+  }
+}
+
+static void build_constrained_summary(const std::vector<uint8_t>& term_states,
+				      const std::vector<uint8_t>& pair_states,
+				      const std::vector<uint8_t>& basis_states,
+				      ConstrainedSummary& summary) {
+  Index n = term_states.size();
+  summary.terms.assign(n, 0);
+  summary.bases.assign(basis_states.size(), 0);
+  summary.visited = 0;
+  summary.skipped = 0;
+  for(Index i = 0; i < n; ++i) {
+    if(term_states[i] != SET_ANY) {
+      mark_term_constrained(i, summary);
+    }
+  }
+  Index pair_idx = 0;
+  for(Index j = 1; j < n; ++j) {
+    for(Index i = 0; i < j; ++i, ++pair_idx) {
+      if(pair_states[pair_idx] != SET_ANY_ANY) {
+	mark_term_constrained(i, summary);
+	mark_term_constrained(j, summary);
+      }
+    }
+  }
+  Index i = 0, j = 1, k = 2, ij_idx = 0, ik_idx = 1, jk_idx = 2;
+  for(Index basis_idx = 0; basis_idx < basis_states.size();
+      ++basis_idx,
+	BasisPairIterator::advance_basis(i, j, k, ij_idx, ik_idx, jk_idx)) {
+    if(basis_states[basis_idx] != SET_ANY_ANY_ANY) {
+      mark_term_constrained(i, summary);
+      mark_term_constrained(j, summary);
+      mark_term_constrained(k, summary);
+    }
+  }
+}
+
+static inline bool basis_pair_unconstrained(const BasisPair& bp,
+					    const ConstrainedSummary& summary) {
+  return !(summary.bases[bp.basis1_idx] | summary.bases[bp.basis2_idx]);
+}
+
+// ensure_basis_consistency only writes states among the terms of the
+// basis pair, so after a visit only those terms can have become
+// constrained
+template <typename TermStates, typename PairStates, typename BasisStates>
+static void refresh_constrained_summary(const BasisPair& bp,
+					const TermStates& term_states,
+					const PairStates& pair_states,
+					const BasisStates& basis_states,
+					ConstrainedSummary& summary) {
+  const std::vector<uint8_t>& constrained = summary.terms;
+  if(constrained[bp.i1] & constrained[bp.j1] & constrained[bp.k1] &
+     constrained[bp.i2] & constrained[bp.j2] & constrained[bp.k2]) {
+    return;
+  }
+  Index terms[6] = {bp.i1, bp.j1, bp.k1, bp.i2, bp.j2, bp.k2};
+  std::sort(terms, terms + 6);
+  size_t term_count = std::unique(terms, terms + 6) - terms;
+
+  for(size_t a = 0; a < term_count; ++a) {
+    if(term_states[terms[a]] != SET_ANY) {
+      mark_term_constrained(terms[a], summary);
+    }
+  }
+  for(size_t b = 1; b < term_count; ++b) {
+    for(size_t a = 0; a < b; ++a) {
+      if(pair_states[pair2d(terms[a], terms[b])] != SET_ANY_ANY) {
+	mark_term_constrained(terms[a], summary);
+	mark_term_constrained(terms[b], summary);
+      }
+    }
+  }
+  for(size_t c = 2; c < term_count; ++c) {
+    for(size_t b = 1; b < c; ++b) {
+      for(size_t a = 0; a < b; ++a) {
+	if(basis_states[pair3d(terms[a], terms[b], terms[c])] !=
+	   SET_ANY_ANY_ANY) {
+	  mark_term_constrained(terms[a], summary);
+	  mark_term_constrained(terms[b], summary);
+	  mark_term_constrained(terms[c], summary);
+	}
+      }
+    }
+  }
+}
+
+// event driven version of ensure_global_consistency.  the first pass
+// sweeps every basis pair in the range.  the kernel runs on tracked
+// states that mark every state it narrows, and each later pass only
+// visits the basis pairs that read a state the pass before it
+// narrowed.  when that would visit more than the whole range, the
+// pass sweeps the range instead and, like the small engine, skips
+// the basis pairs none of whose terms saw a change since their visit
+// in the previous sweep.  the two sets of marks are allocated once
+// and reused.
+static bool worklist_ensure_global_consistency
+(std::vector<uint8_t>& term_states,
+ std::vector<uint8_t>& pair_states,
+ std::vector<uint8_t>& basis_states,
+ bool& has_contradiction,
+ Index starting_basis_pair,
+ Index ending_basis_pair,
+ std::atomic<bool>* cancel,
+ ConstrainedSummary* summary) {
+  has_contradiction = false;
+  bool globally_changed = false;
+  const Index n = term_states.size();
+  ChangedStates dirty;
+  ChangedStates changed;
+  dirty.reset(n);
+  changed.reset(n);
+  Index writes = 0;
+  TrackedStates terms(term_states, changed.terms, writes);
+  TrackedStates pairs(pair_states, changed.pairs, writes);
+  TrackedStates bases(basis_states, changed.bases, writes);
+  // step of the last change to a state over each term, counting basis
+  // pair visits over all passes
+  std::vector<Index> changed_at(n, 0);
+  Index step = 0;
+  CombineCache* cache = thread_combine_cache();
+  Index until_poll = STOP_POLL_INTERVAL;
+  auto visit = [&](const BasisPair& bp) {
+    if(--until_poll == 0) {
+      until_poll = STOP_POLL_INTERVAL;
+      if(engine_should_stop(cancel)) {
+	return false;
+      }
+    }
+    ++step;
+    if(summary) {
+      ++summary->visited;
+      if(basis_pair_unconstrained(bp, *summary)) {
+	++summary->skipped;
+	return true;
+      }
+    }
+    const Index writes_before = writes;
+    auto result = ensure_basis_consistency_impl<false>(bp, terms, pairs,
+							bases, cache);
+    if(summary) {
+      refresh_constrained_summary(bp, term_states, pair_states,
+				  basis_states, *summary);
+    }
+    if (result.has_zero) {
+      has_contradiction = true;
+      cancel_run(cancel);
+      return false;
+    }
+    if(writes != writes_before) {
+      const Index terms_touched[6] = {bp.i1, bp.j1, bp.k1,
+				      bp.i2, bp.j2, bp.k2};
+      for(Index term : terms_touched) {
+	changed_at[term] = step;
+      }
+    }
+    return true;
+  };
+  // step before the first visit of the previous sweep of the range,
+  // none yet
+  Index last_sweep = 0;
+  bool swept = false;
+  auto sweep = [&]() {
+    const Index sweep_start = step;
+    for(BasisPairIterator it(starting_basis_pair);
+	it.basis_pair() < ending_basis_pair;
+	it.next()) {
+      const BasisPair& bp = it.current();
+      if(swept &&
+	 std::max({changed_at[bp.i1], changed_at[bp.j1], changed_at[bp.k1],
+		   changed_at[bp.i2], changed_at[bp.j2], changed_at[bp.k2]})
+	 <= last_sweep + (step - sweep_start)) {
+	// nothing it reads changed since its visit in the last sweep
+	++step;
+	continue;
+      }
+      if(!visit(bp)) {
+	return false;
+      }
+    }
+    last_sweep = sweep_start;
+    swept = true;
+    return true;
+  };
+  // the marks, not the kernel's changed flag, decide whether another
+  // pass is needed: a pass that narrows nothing marks nothing
+  bool finished = sweep();
+  while (finished && changed.any()) {
+    globally_changed = true;
+    dirty.swap(changed);
+    changed.clear();
+    // the swap moved the marks the trackers pointed at
+    terms = TrackedStates(term_states, changed.terms, writes);
+    pairs = TrackedStates(pair_states, changed.pairs, writes);
+    bases = TrackedStates(basis_states, changed.bases, writes);
+    if(dirty_walk_exceeds_pass(dirty, n, starting_basis_pair,
+			       ending_basis_pair)) {
+      finished = sweep();
+    } else {
+      finished = visit_dirty_basis_pairs(dirty, n, starting_basis_pair,
+					 ending_basis_pair, visit);
+    }
+  }
+  // like the sweeps, a pass cut short by a stop request reports no
+  // change of its own
+  return has_contradiction || globally_changed;
+}
+
+// How a sweep cuts the basis pairs into tiles, see visit_basis_pairs
+struct Tiling {
+  Index bases;			// options.tile_size
+  Index terms;			// options.tile_terms
+  bool report;			// print the progress of every pass
+};
+
+// only term tiles, the out of core sweep, are slow enough to report
+static Tiling tiling_of(const ConsistencyOptions& options,
+			bool report = false) {
+  return Tiling{options.tile_size, options.tile_terms,
+		report && options.tile_terms != 0};
+}
+
+// Call visit(bp) for every basis pair in [starting_basis_pair,
+// ending_basis_pair), stopping early if visit returns false.  with
+// no tiling the pairs are walked in index order.  otherwise the
+// (basis1, basis2) triangle is cut into tiles that are finished one
+// at a time, every pair in the range is still visited exactly once.
+//
+// tiling.bases cuts tiles of tiling.bases x tiling.bases bases.  the
+// bases of one tile are close together in the pair3d layout so the
+// terms, pairs and intermediary bases a tile touches stay in cache
+// while it is swept.
+//
+// tiling.terms cuts the largest terms of both bases into ranges of
+// tiling.terms terms instead.  pair3d keeps the bases of
+// largest term k in slab k, so a tile reads two runs of whole slabs
+// from start to end, and so do most of its intermediaries, which
+// share a largest term with one of the bases.  that is what keeps a
+// basis_states that does not fit in memory paging in order.
+template <typename Visit>
+static void visit_basis_pairs(Index starting_basis_pair,
+			      Index ending_basis_pair,
+			      const Tiling& tiling,
+			      Visit visit) {
+  if(tiling.bases == 0 && tiling.terms == 0) {
+    for(BasisPairIterator it(starting_basis_pair);
+	it.basis_pair() < ending_basis_pair;
+	it.next()) {
+      if(!visit(it.current())) {
+	return;
+      }
+    }
+    return;
+  }
+  if(ending_basis_pair <= starting_basis_pair) {
+    return;
+  }
+  Index first_basis1, first_basis2, last_basis1, last_basis2;
+  std::tie(first_basis1, first_basis2) = unpair2d(starting_basis_pair);
+  std::tie(last_basis1, last_basis2) = unpair2d(ending_basis_pair - 1);
+  // first basis of the tile after the one basis is in
+  auto next_tile = [&](Index basis) -> Index {
+    if(tiling.terms == 0) {
+      return basis + tiling.bases;
+    }
+    Index i, j, k;
+    std::tie(i, j, k) = unpair3d(basis);
+    return tetrahedral((k / tiling.terms + 1) * tiling.terms);
+  };
+  // tile(row, row_end, column, column_end) for every tile in order
+  auto for_each_tile = [&](auto tile) {
+    for(Index row = first_basis2; row <= last_basis2; row = next_tile(row)) {
+      Index row_end = std::min(next_tile(row), last_basis2 + 1);
+      for(Index column = 0; column < row_end; column = next_tile(column)) {
+	if(!tile(row, row_end, column, next_tile(column))) {
+	  return;
+	}
+      }
+    }
+  };
+  Index num_tiles = 0;
+  Index tiles_done = 0;
+  if(tiling.report) {
+    for_each_tile([&](Index, Index, Index, Index) {
+      ++num_tiles;
+      return true;
+    });
+  }
+  for_each_tile([&](Index row, Index row_end,
+		    Index column, Index column_end) {
+    for(Index basis2 = row; basis2 < row_end; ++basis2) {
+      // the range may start and end part way through a row
+      Index low = (basis2 == first_basis2) ? first_basis1 : 0;
+      Index high = (basis2 == last_basis2) ? last_basis1 + 1 : basis2;
+      low = std::max(low, column);
+      high = std::min(high, column_end);
+      if(low >= high) {
+	continue;
+      }
+      BasisPairIterator it(pair2d(low, basis2));
+      for(Index basis1 = low; basis1 < high; ++basis1, it.next()) {
+	if(!visit(it.current())) {
+	  return false;
+	}
+      }
+    }
+    ++tiles_done;
+    // about every tenth of a pass
+    if(tiling.report &&
+       (tiles_done * 10 / num_tiles != (tiles_done - 1) * 10 / num_tiles)) {
+      std::cout << "- Swept tile " << tiles_done << " of " << num_tiles
+		<< std::endl;
+    }
+    return true;
+  });
+}
+
+// sweep the basis pairs in [starting_basis_pair, ending_basis_pair)
+// until a pass changes nothing.  with Shared = true several workers
+// may sweep disjoint ranges of the same store at once.  a pass cut
+// short by a stop request reports no change so the callers fall out
+// of their loops.  summary, when given, skips unconstrained basis
+// pairs and is only valid for a private store (Shared = false).
+template <bool Shared, typename TermStates, typename PairStates,
+	  typename BasisStates>
+static bool sweep_basis_pairs_once(TermStates& term_states,
+				   PairStates& pair_states,
+				   BasisStates& basis_states,
+				   bool& has_contradiction,
+				   Index starting_basis_pair,
+				   Index ending_basis_pair,
+				   const Tiling& tiling,
+				   std::atomic<bool>* cancel,
+				   ConstrainedSummary* summary = nullptr) {
+  bool changed = false;
+  bool stopped = false;
+  CombineCache* cache = thread_combine_cache();
+  Index until_poll = STOP_POLL_INTERVAL;
+  visit_basis_pairs(starting_basis_pair, ending_basis_pair, tiling,
+		    [&](const BasisPair& bp) {
+    if(--until_poll == 0) {
+      until_poll = STOP_POLL_INTERVAL;
+      if(engine_should_stop(cancel)) {
+	stopped = true;
+	return false;
+      }
+    }
+    if(summary) {
+      ++summary->visited;
+      if(basis_pair_unconstrained(bp, *summary)) {
+	++summary->skipped;
+	return true;
+      }
+    }
+    auto result =
+      ensure_basis_consistency_impl<Shared>(bp,
+					    term_states,
+					    pair_states,
+					    basis_states,
+					    cache);
+    if(summary) {
+      refresh_constrained_summary(bp, term_states, pair_states,
+				  basis_states, *summary);
+    }
+    if (result.has_zero) {
+      has_contradiction = true;
+      cancel_run(cancel);
+      return false;
+    }
+                        
+    if (result.changed) {
+      changed = true;
+    }
+    return true;
+  });
+  if (has_contradiction) {
+    return true;
+  }
+  return stopped ? false : changed;
+}
+
+template <bool Shared, typename TermStates, typename PairStates,
+	  typename BasisStates>
+static bool sweep_basis_pairs(TermStates& term_states,
+			      PairStates& pair_states,
+			      BasisStates& basis_states,
+			      bool& has_contradiction,
+			      Index starting_basis_pair,
+			      Index ending_basis_pair,
+			      const Tiling& tiling,
+			      std::atomic<bool>* cancel,
+			      ConstrainedSummary* summary = nullptr) {
+  has_contradiction = false;
+  bool changed = true;
+  bool globally_changed = false;
+  while (changed) {
+    changed = sweep_basis_pairs_once<Shared>(term_states,
+					     pair_states,
+					     basis_states,
+					     has_contradiction,
+					     starting_basis_pair,
+					     ending_basis_pair,
+					     tiling,
+					     cancel,
+					     summary);
+    if (has_contradiction) {
+      return true;
+    }
+    globally_changed = globally_changed || changed;
+  }
+  return globally_changed;
+}
+
+// options.row_propagation: sweep the rows of every basis the basis
+// pair range [starting_basis_pair, ending_basis_pair) touches.  the
+// engine applies update_basis_states to all of those bases anyway so
+// this only gets to the same fixpoint sooner.  ranges that stop short
+// of the last basis pair (the copy-and-merge segments) are left
+// alone.  returns true if anything changed.
+static bool propagate_basis_rows(std::vector<uint8_t>& term_states,
+				 std::vector<uint8_t>& pair_states,
+				 std::vector<uint8_t>& basis_states,
+				 bool& has_contradiction,
+				 Index starting_basis_pair,
+				 Index ending_basis_pair,
+				 const ConsistencyOptions& options) {
+  const Index num_bases = basis_states.size();
+  if (!options.row_propagation ||
+      starting_basis_pair >= ending_basis_pair ||
+      ending_basis_pair != calculate_array_size_2d(num_bases)) {
+    return false;
+  }
+  // a suffix of basis pairs starting at (basis1, basis2) pairs every
+  // basis with the last one unless basis2 already is the last one
+  Index basis1, basis2;
+  std::tie(basis1, basis2) = unpair2d(starting_basis_pair);
+  Index first_basis = (basis2 + 1 < num_bases) ? 0 : basis1;
+  return sweep_basis_rows(term_states, pair_states, basis_states,
+			  has_contradiction, first_basis);
+}
+
+static bool ensure_global_consistency_impl
+(std::vector<uint8_t>& term_states,
+ std::vector<uint8_t>& pair_states,
+ std::vector<uint8_t>& basis_states,
+ bool& has_contradiction,
+ Index starting_basis_pair,
+ Index ending_basis_pair,
+ const ConsistencyOptions& options,
+ std::atomic<bool>* cancel,
+ ConstrainedSummary& summary) {
+  // only the sequential engine, which has no cancel flag, reports
+  const Tiling tiling = tiling_of(options, cancel == nullptr);
+  ConstrainedSummary* active_summary = nullptr;
+  if(options.skip_unconstrained) {
+    build_constrained_summary(term_states, pair_states, basis_states,
+			      summary);
+    active_summary = &summary;
+  }
+  if(options.use_worklist) {
+    return worklist_ensure_global_consistency(term_states,
+					      pair_states,
+					      basis_states,
+					      has_contradiction,
+					      starting_basis_pair,
+					      ending_basis_pair,
+					      cancel,
+					      active_summary);
+  }
+  if(options.row_propagation) {
+    // alternate the cheap row sweep with full sweeps
+    bool changed = true;
+    bool globally_changed = false;
+    while (changed) {
+      changed = propagate_basis_rows(term_states,
+				     pair_states,
+				     basis_states,
+				     has_contradiction,
+				     starting_basis_pair,
+				     ending_basis_pair,
+				     options);
+      if (has_contradiction) {
+	return true;
+      }
+      globally_changed = globally_changed || changed;
+      changed = sweep_basis_pairs_once<false>(term_states,
+					      pair_states,
+					      basis_states,
+					      has_contradiction,
+					      starting_basis_pair,
+					      ending_basis_pair,
+					      tiling,
+					      cancel,
+					      active_summary);
+      if (has_contradiction) {
+	return true;
+      }
+      globally_changed = globally_changed || changed;
+    }
+    return globally_changed;
+  }
+  return sweep_basis_pairs<false>(term_states,
+				  pair_states,
+				  basis_states,
+				  has_contradiction,
+				  starting_basis_pair,
+				  ending_basis_pair,
+				  tiling,
+				  cancel,
+				  active_summary);
+}
+
+// the worklist and the summaries keep a byte per state of their own
+// and the row sweep runs SIMD kernels over plain bytes, so stores
+// other than the dense one only get the plain and tiled sweeps
+static void require_plain_sweep(const ConsistencyOptions& options) {
+  if (options.use_worklist || options.skip_unconstrained ||
+      options.row_propagation) {
+    throw std::invalid_argument("this state store only supports the "
+				"plain and tiled sweeps");
+  }
+}
+
+template <typename TermStates, typename PairStates, typename BasisStates>
+static bool ensure_global_consistency_impl
+(TermStates& term_states,
+ PairStates& pair_states,
+ BasisStates& basis_states,
+ bool& has_contradiction,
+ Index starting_basis_pair,
+ Index ending_basis_pair,
+ const ConsistencyOptions& options,
+ std::atomic<bool>* cancel,
+ ConstrainedSummary& /* summary */) {
+  require_plain_sweep(options);
+  // only the sequential engine, which has no cancel flag, reports
+  return sweep_basis_pairs<false>(term_states,
+				  pair_states,
+				  basis_states,
+				  has_contradiction,
+				  starting_basis_pair,
+				  ending_basis_pair,
+				  tiling_of(options, cancel == nullptr),
+				  cancel);
+}
+
+template <typename TermStates, typename PairStates, typename BasisStates>
+static bool propagate_basis_rows(TermStates& /* term_states */,
+				 PairStates& /* pair_states */,
+				 BasisStates& /* basis_states */,
+				 bool& /* has_contradiction */,
+				 Index /* starting_basis_pair */,
+				 Index /* ending_basis_pair */,
+				 const ConsistencyOptions& options) {
+  require_plain_sweep(options);
+  return false;
+}
+
+static void report_skipped_pairs(Index skipped, Index visited) {
+  std::cout << "- Skipped unconstrained basis pairs: " << skipped
+	    << " of " << visited << std::endl;
+}
+
+template <typename TermStates, typename PairStates, typename BasisStates>
+static bool sequential_ensure_global_consistency
+(TermStates& term_states,
+ PairStates& pair_states,
+ BasisStates& basis_states,
+ bool& has_contradiction,
+ Index starting_basis_pair,
+ Index ending_basis_pair,
+ const ConsistencyOptions& options) {
+  ConstrainedSummary summary;
+  bool changed = ensure_global_consistency_impl(term_states,
+						pair_states,
+						basis_states,
+						has_contradiction,
+						starting_basis_pair,
+						ending_basis_pair,
+						options,
+						nullptr,
+						summary);
+  if(options.skip_unconstrained) {
+    report_skipped_pairs(summary.skipped, summary.visited);
+  }
+  return changed;
+}
+
+bool ensure_global_consistency(std::vector<uint8_t>& term_states,
+			       std::vector<uint8_t>& pair_states,
+			       std::vector<uint8_t>& basis_states,
+			       bool& has_contradiction,
+			       Index starting_basis_pair,
+			       Index ending_basis_pair,
+			       const ConsistencyOptions& options) {
+  return sequential_ensure_global_consistency(term_states,
+					      pair_states,
+					      basis_states,
+					      has_contradiction,
+					      starting_basis_pair,
+					      ending_basis_pair,
+					      options);
+}
+
+template <typename Store>
+bool ensure_global_consistency(Store& states,
+			       bool& has_contradiction,
+			       Index starting_basis_pair,
+			       Index ending_basis_pair,
+			       const ConsistencyOptions& options) {
+  return sequential_ensure_global_consistency(states.terms,
+					      states.pairs,
+					      states.bases,
+					      has_contradiction,
+					      starting_basis_pair,
+					      ending_basis_pair,
+					      options);
+}
+
+// Structure to hold work segment boundaries
+struct WorkSegment {
+  Index starting_basis_pair;
+  Index ending_basis_pair;
+};
+
+// Structure to hold worker results.  states is the worker's own copy
+// of the store in copy mode.
+template <typename Store = DenseStateStore>
+struct WorkerResult {
+  Index updates;
+  bool has_contradiction;
+  bool has_changed;
+  Store states;
+  // work stealing telemetry
+  double busy_ms = 0;
+  Index tasks_run = 0;
+  Index tasks_stolen = 0;
+  // basis pairs seen and skipped as unconstrained
+  Index pairs_visited = 0;
+  Index pairs_skipped = 0;
+};
+
+// Function to divide a range of basis pairs among workers
+std::vector<WorkSegment> divide_work(Index starting_basis_pair,
+				     Index ending_basis_pair,
+				     int num_workers) {
+  std::vector<WorkSegment> segments;
+
+  // determine_solution can hand us a start past the end
+  Index num_basis_pairs = (ending_basis_pair > starting_basis_pair) ?
+    ending_basis_pair - starting_basis_pair : 0;
+  Index basis_pairs_per_worker = num_basis_pairs / num_workers;
   Index remainder_pairs = num_basis_pairs % num_workers;
-  Index current_position = 0;
+  Index current_position = starting_basis_pair;
   for(int worker = 0; worker < num_workers; ++worker) {
     WorkSegment segment;
     segment.starting_basis_pair = current_position;
@@ -1299,20 +2799,28 @@ std::vector<WorkSegment> divide_work(Index n, int num_workers) {
   return segments;
 }
 
+// Function to divide all basis pairs of n terms among workers
+std::vector<WorkSegment> divide_work(Index n, int num_workers) {
+  return divide_work(0,
+		     calculate_array_size_2d(calculate_array_size_3d(n)),
+		     num_workers);
+}
+
 // Function to merge worker results
-bool merge_worker_results(std::vector<WorkerResult>& worker_results,
-			  std::vector<uint8_t>& term_states,
-			  std::vector<uint8_t>& pair_states,
-			  std::vector<uint8_t>& basis_states,
+template <typename Store>
+bool merge_worker_results(std::vector<WorkerResult<Store>>& worker_results,
+			  typename Store::TermStates& term_states,
+			  typename Store::PairStates& pair_states,
+			  typename Store::BasisStates& basis_states,
 			  bool& has_contradiction) {
     
   bool changed = false;
   has_contradiction = false;  // Initialize to false
     
   // Initialize with the first worker's results
-  term_states = worker_results[0].term_states;
-  pair_states = worker_results[0].pair_states;
-  basis_states = worker_results[0].basis_states;
+  term_states = std::move(worker_results[0].states.terms);
+  pair_states = std::move(worker_results[0].states.pairs);
+  basis_states = std::move(worker_results[0].states.bases);
     
   if (worker_results[0].has_contradiction) {
     has_contradiction = true;
@@ -1329,34 +2837,11 @@ bool merge_worker_results(std::vector<WorkerResult>& worker_results,
     }
         
     // Intersection of allowed states (bitwise AND)
-    for (size_t j = 0; j < term_states.size(); j++) {
-      uint8_t old_term = term_states[j];
-      term_states[j] &= worker.term_states[j];
-      if (term_states[j] != old_term) changed = true;
-      if (term_states[j] == 0) {
-	has_contradiction = true;
-	return false; // Contradiction detected during merge
-      }
-    }
-        
-    for (size_t j = 0; j < pair_states.size(); j++) {
-      uint8_t old_pair = pair_states[j];
-      pair_states[j] &= worker.pair_states[j];
-      if (pair_states[j] != old_pair) changed = true;
-      if (pair_states[j] == 0) {
-	has_contradiction = true;
-	return false; // Contradiction detected during merge
-      }
-    }
-        
-    for (size_t j = 0; j < basis_states.size(); j++) {
-      uint8_t old_basis = basis_states[j];
-      basis_states[j] &= worker.basis_states[j];
-      if (basis_states[j] != old_basis) changed = true;
-      if (basis_states[j] == 0) {
-	has_contradiction = true;
-	return false; // Contradiction detected during merge
-      }
+    if (!narrow_states(term_states, worker.states.terms, changed) ||
+	!narrow_states(pair_states, worker.states.pairs, changed) ||
+	!narrow_states(basis_states, worker.states.bases, changed)) {
+      has_contradiction = true;
+      return false; // Contradiction detected during merge
     }
   }
     
@@ -1364,72 +2849,391 @@ bool merge_worker_results(std::vector<WorkerResult>& worker_results,
 }
 
 // Worker function that processes a segment
-WorkerResult process_segment(const WorkSegment& segment,
-			     const std::vector<uint8_t>& term_states,
-			     const std::vector<uint8_t>& pair_states,
-			     const std::vector<uint8_t>& basis_states) {
+template <typename TermStates, typename PairStates, typename BasisStates>
+WorkerResult<StateStore<TermStates, PairStates, BasisStates>>
+process_segment(const WorkSegment& segment,
+		const TermStates& term_states,
+		const PairStates& pair_states,
+		const BasisStates& basis_states,
+		const ConsistencyOptions& options,
+		std::atomic<bool>* cancel) {
     
-  WorkerResult result;
-  result.term_states = term_states;
-  result.pair_states = pair_states;
-  result.basis_states = basis_states;
+  WorkerResult<StateStore<TermStates, PairStates, BasisStates>> result;
+  // reserved first so the copy lands on huge pages when they are on
+  result.states.reserve_terms(term_states.size());
+  result.states.terms = term_states;
+  result.states.pairs = pair_states;
+  result.states.bases = basis_states;
   result.has_contradiction = false;
     
   // Process this segment
+  ConstrainedSummary summary;
   result.has_changed =
-    ensure_global_consistency(result.term_states,
-			      result.pair_states,
-			      result.basis_states,
-			      result.has_contradiction,
-			      segment.starting_basis_pair,
-			      segment.ending_basis_pair);
+    ensure_global_consistency_impl(result.states.terms,
+				   result.states.pairs,
+				   result.states.bases,
+				   result.has_contradiction,
+				   segment.starting_basis_pair,
+				   segment.ending_basis_pair,
+				   options,
+				   cancel,
+				   summary);
+  result.pairs_visited = summary.visited;
+  result.pairs_skipped = summary.skipped;
   return result;
 }
 
-bool parallel_ensure_global_consistency
+// Run worker_fn(worker) for every worker and collect the results,
+// either on the persistent pool or on freshly spawned threads
+template <typename WorkerFn,
+	  typename Result = decltype(std::declval<WorkerFn>()(0))>
+static std::vector<Result> run_workers(int num_workers,
+				       const ConsistencyOptions& options,
+				       WorkerFn worker_fn) {
+  std::vector<Result> worker_results(num_workers);
+  if (options.use_pool) {
+    shared_worker_pool(num_workers).run([&](int worker) {
+      worker_results[worker] = worker_fn(worker);
+    });
+    return worker_results;
+  }
+  std::vector<std::future<Result>> futures;
+  for (int worker = 0; worker < num_workers; ++worker) {
+    futures.push_back(std::async(std::launch::async, worker_fn, worker));
+  }
+  for (int worker = 0; worker < num_workers; ++worker) {
+    worker_results[worker] = futures[worker].get();
+  }
+  return worker_results;
+}
+
+// Worker function that sweeps a segment of the shared store in place
+WorkerResult<> process_shared_segment(const WorkSegment& segment,
+				      std::vector<uint8_t>& term_states,
+				      std::vector<uint8_t>& pair_states,
+				      std::vector<uint8_t>& basis_states,
+				      const Tiling& tiling,
+				      std::atomic<bool>* cancel) {
+  WorkerResult<> result;
+  result.has_contradiction = false;
+  result.has_changed =
+    sweep_basis_pairs<true>(term_states,
+			    pair_states,
+			    basis_states,
+			    result.has_contradiction,
+			    segment.starting_basis_pair,
+			    segment.ending_basis_pair,
+			    tiling,
+			    cancel);
+  return result;
+}
+
+// shared-state version of parallel_ensure_global_consistency.  all
+// workers prune one store with atomic ANDs so they see each other's
+// changes right away and there is nothing to copy or merge.  we stop
+// once an iteration in which every worker swept its whole segment
+// changed nothing.
+static bool shared_parallel_ensure_global_consistency
 (std::vector<uint8_t>& term_states,
  std::vector<uint8_t>& pair_states,
  std::vector<uint8_t>& basis_states,
  bool& has_contradiction,
  Index starting_basis_pair,
  Index ending_basis_pair,
- int num_workers) {
-  if(num_workers < 2) {
-    // fallback to sequential solver if only one worker
-    return ensure_global_consistency(term_states,
+ int num_workers,
+ const ConsistencyOptions& options) {
+  auto start = std::chrono::high_resolution_clock::now();
+  bool changed = true;
+  bool globally_changed = false;
+  has_contradiction = false;
+  int iterations = 0;
+  auto work_segments =
+    divide_work(starting_basis_pair, ending_basis_pair, num_workers);
+  std::atomic<bool> cancel(false);
+  while (changed && !has_contradiction && !engine_should_stop(&cancel)) {
+    ++iterations;
+    std::cout << "Iteration " << iterations << "..." << std::endl;
+    if (propagate_basis_rows(term_states, pair_states, basis_states,
+			     has_contradiction, starting_basis_pair,
+			     ending_basis_pair, options)) {
+      globally_changed = true;
+    }
+    if (has_contradiction) {
+      break;
+    }
+
+    auto worker_results =
+      run_workers(num_workers, options, [&](int worker) {
+	return process_shared_segment(work_segments[worker],
+				      term_states,
+				      pair_states,
+				      basis_states,
+				      tiling_of(options),
+				      &cancel);
+      });
+
+    changed = false;
+    for (const auto& worker : worker_results) {
+      changed = changed || worker.has_changed;
+      has_contradiction = has_contradiction || worker.has_contradiction;
+    }
+    globally_changed = (globally_changed || changed);
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  auto duration =
+    std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+  std::cout << "Results:\n";
+  std::cout << "- Iterations: " << iterations << std::endl;
+  std::cout << "- Contradiction detected: "
+	    << (has_contradiction ? "Yes" : "No") << std::endl;
+  std::cout << "- Time taken: " << duration.count() << " ms" << std::endl;
+  return globally_changed;
+}
+
+// A queue of basis pair tasks owned by one worker.  the owner takes
+// tasks from the front so it walks its block in order, idle workers
+// steal from the back.
+struct TaskQueue {
+  std::mutex lock;
+  std::deque<WorkSegment> tasks;
+};
+
+// Split [starting_basis_pair, ending_basis_pair) into tasks of
+// task_size basis pairs and deal them out to the workers in
+// contiguous blocks
+static void fill_task_queues(std::vector<TaskQueue>& queues,
+			     Index starting_basis_pair,
+			     Index ending_basis_pair,
+			     Index task_size) {
+  Index num_pairs = (ending_basis_pair > starting_basis_pair) ?
+    ending_basis_pair - starting_basis_pair : 0;
+  Index num_tasks = (num_pairs + task_size - 1) / task_size;
+  for(Index task = 0; task < num_tasks; ++task) {
+    WorkSegment segment;
+    segment.starting_basis_pair = starting_basis_pair + task * task_size;
+    segment.ending_basis_pair =
+      std::min(segment.starting_basis_pair + task_size, ending_basis_pair);
+    queues[(task * queues.size()) / num_tasks].tasks.push_back(segment);
+  }
+}
+
+// Take the next task for worker, stealing from the other queues once
+// our own runs dry.  no tasks are added during an iteration so once
+// every queue is empty we are done.
+static bool next_task(std::vector<TaskQueue>& queues,
+		      size_t worker,
+		      WorkSegment& task,
+		      bool& stolen) {
+  {
+    std::lock_guard<std::mutex> guard(queues[worker].lock);
+    if(!queues[worker].tasks.empty()) {
+      task = queues[worker].tasks.front();
+      queues[worker].tasks.pop_front();
+      stolen = false;
+      return true;
+    }
+  }
+  for(size_t offset = 1; offset < queues.size(); ++offset) {
+    TaskQueue& victim = queues[(worker + offset) % queues.size()];
+    std::lock_guard<std::mutex> guard(victim.lock);
+    if(!victim.tasks.empty()) {
+      task = victim.tasks.back();
+      victim.tasks.pop_back();
+      stolen = true;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Worker function for the work stealing scheduler.  each task gets
+// one pass.  in shared mode the worker prunes the shared store, in
+// copy mode it prunes its own copy that is merged afterwards.
+template <bool Shared>
+WorkerResult<> process_tasks(size_t worker,
+			     std::vector<TaskQueue>& queues,
+			     std::vector<uint8_t>& term_states,
+			     std::vector<uint8_t>& pair_states,
+			     std::vector<uint8_t>& basis_states,
+			     const Tiling& tiling,
+			     std::atomic<bool>* cancel) {
+  WorkerResult<> result;
+  result.has_contradiction = false;
+  result.has_changed = false;
+  std::vector<uint8_t>* terms = &term_states;
+  std::vector<uint8_t>* pairs = &pair_states;
+  std::vector<uint8_t>* bases = &basis_states;
+  if(!Shared) {
+    result.states.reserve_terms(term_states.size());
+    result.states.terms = term_states;
+    result.states.pairs = pair_states;
+    result.states.bases = basis_states;
+    terms = &result.states.terms;
+    pairs = &result.states.pairs;
+    bases = &result.states.bases;
+  }
+  WorkSegment task;
+  bool stolen = false;
+  while(!engine_should_stop(cancel) &&
+	next_task(queues, worker, task, stolen)) {
+    auto start = std::chrono::steady_clock::now();
+    bool changed =
+      sweep_basis_pairs_once<Shared>(*terms, *pairs, *bases,
+				     result.has_contradiction,
+				     task.starting_basis_pair,
+				     task.ending_basis_pair,
+				     tiling,
+				     cancel);
+    auto end = std::chrono::steady_clock::now();
+    result.busy_ms +=
+      std::chrono::duration<double, std::milli>(end - start).count();
+    ++result.tasks_run;
+    if(stolen) {
+      ++result.tasks_stolen;
+    }
+    result.has_changed = result.has_changed || changed;
+    if(result.has_contradiction) {
+      break;
+    }
+  }
+  return result;
+}
+
+// parallel_ensure_global_consistency with the basis pair range cut
+// into many small tasks that idle workers steal from busy ones
+static bool stealing_parallel_ensure_global_consistency
+(std::vector<uint8_t>& term_states,
+ std::vector<uint8_t>& pair_states,
+ std::vector<uint8_t>& basis_states,
+ bool& has_contradiction,
+ Index starting_basis_pair,
+ Index ending_basis_pair,
+ int num_workers,
+ const ConsistencyOptions& options) {
+  auto start = std::chrono::high_resolution_clock::now();
+  bool changed = true;
+  bool globally_changed = false;
+  has_contradiction = false;
+  int iterations = 0;
+  Index task_size = std::max<Index>(1, options.task_size);
+  std::vector<double> busy_ms(num_workers, 0);
+  std::vector<Index> tasks_run(num_workers, 0);
+  std::vector<Index> tasks_stolen(num_workers, 0);
+  std::atomic<bool> cancel(false);
+  while (changed && !has_contradiction && !engine_should_stop(&cancel)) {
+    ++iterations;
+    std::cout << "Iteration " << iterations << "..." << std::endl;
+    if (propagate_basis_rows(term_states, pair_states, basis_states,
+			     has_contradiction, starting_basis_pair,
+			     ending_basis_pair, options)) {
+      globally_changed = true;
+    }
+    if (has_contradiction) {
+      break;
+    }
+
+    std::vector<TaskQueue> queues(num_workers);
+    fill_task_queues(queues, starting_basis_pair, ending_basis_pair,
+		     task_size);
+
+    auto worker_results =
+      run_workers(num_workers, options, [&](int worker) {
+	return options.shared_state ?
+	  process_tasks<true>(worker, queues,
+			      term_states, pair_states, basis_states,
+			      tiling_of(options), &cancel) :
+	  process_tasks<false>(worker, queues,
+			       term_states, pair_states, basis_states,
+			       tiling_of(options), &cancel);
+      });
+    for (int worker = 0; worker < num_workers; ++worker) {
+      busy_ms[worker] += worker_results[worker].busy_ms;
+      tasks_run[worker] += worker_results[worker].tasks_run;
+      tasks_stolen[worker] += worker_results[worker].tasks_stolen;
+    }
+
+    if (options.shared_state) {
+      changed = false;
+      for (const auto& worker : worker_results) {
+	changed = changed || worker.has_changed;
+	has_contradiction = has_contradiction || worker.has_contradiction;
+      }
+    } else {
+      changed = merge_worker_results(worker_results,
+				     term_states,
 				     pair_states,
 				     basis_states,
-				     has_contradiction,
-				     starting_basis_pair,
-				     ending_basis_pair);
+				     has_contradiction);
+    }
+    globally_changed = (globally_changed || changed);
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  auto duration =
+    std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+  std::cout << "Results:\n";
+  std::cout << "- Iterations: " << iterations << std::endl;
+  for (int worker = 0; worker < num_workers; ++worker) {
+    std::cout << "- Worker " << worker << ": busy "
+	      << static_cast<Index>(busy_ms[worker]) << " ms, "
+	      << tasks_run[worker] << " tasks ("
+	      << tasks_stolen[worker] << " stolen)" << std::endl;
   }
+  std::cout << "- Contradiction detected: "
+	    << (has_contradiction ? "Yes" : "No") << std::endl;
+  std::cout << "- Time taken: " << duration.count() << " ms" << std::endl;
+  return globally_changed;
+}
+
+// parallel_ensure_global_consistency with every worker sweeping its
+// segment of the basis pairs on a copy of the states and the copies
+// ANDed together after each iteration.  runs on any StateStore's
+// levels, smaller ones make the per-worker copies cheaper.
+template <typename TermStates, typename PairStates, typename BasisStates>
+static bool copy_merge_parallel_ensure_global_consistency
+(TermStates& term_states,
+ PairStates& pair_states,
+ BasisStates& basis_states,
+ bool& has_contradiction,
+ Index starting_basis_pair,
+ Index ending_basis_pair,
+ int num_workers,
+ const ConsistencyOptions& options) {
   auto start = std::chrono::high_resolution_clock::now();
   bool changed = true;
   bool globally_changed = false;
   has_contradiction = false;
   int iterations = 0;
-  while (changed && !has_contradiction) {
+  Index pairs_visited = 0;
+  Index pairs_skipped = 0;
+  std::atomic<bool> cancel(false);
+  while (changed && !has_contradiction && !engine_should_stop(&cancel)) {
     ++iterations;
     std::cout << "Iteration " << iterations << "..." << std::endl;
+    if (propagate_basis_rows(term_states, pair_states, basis_states,
+			     has_contradiction, starting_basis_pair,
+			     ending_basis_pair, options)) {
+      globally_changed = true;
+    }
+    if (has_contradiction) {
+      break;
+    }
 
     // Divide work among workers
     auto work_segments = divide_work(term_states.size(), num_workers);
 
-    // Spawn worker threads
-    std::vector<std::future<WorkerResult>> futures;
-    for (const auto& segment : work_segments) {
-      futures.push_back(std::async(std::launch::async, 
-				   process_segment, 
-				   segment, 
-				   term_states, 
-				   pair_states, 
-				   basis_states));
-    }
-
-    // Collect results
-    std::vector<WorkerResult> worker_results;
-    for (auto& future : futures) {
-      worker_results.push_back(future.get());
+    // Run the workers and collect their results
+    auto worker_results =
+      run_workers(num_workers, options, [&](int worker) {
+	return process_segment(work_segments[worker],
+			       term_states,
+			       pair_states,
+			       basis_states,
+			       options,
+			       &cancel);
+      });
+    for (const auto& worker : worker_results) {
+      pairs_visited += worker.pairs_visited;
+      pairs_skipped += worker.pairs_skipped;
     }
         
     // Merge results
@@ -1448,8 +3252,473 @@ bool parallel_ensure_global_consistency
     std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
   std::cout << "Results:\n";
   std::cout << "- Iterations: " << iterations << std::endl;
+  if (options.skip_unconstrained) {
+    report_skipped_pairs(pairs_skipped, pairs_visited);
+  }
   std::cout << "- Contradiction detected: "
 	    << (has_contradiction ? "Yes" : "No") << std::endl;
   std::cout << "- Time taken: " << duration.count() << " ms" << std::endl;
-  return globally_changed;;
+  return globally_changed;
+}
+
+
+bool parallel_ensure_global_consistency
+(std::vector<uint8_t>& term_states,
+ std::vector<uint8_t>& pair_states,
+ std::vector<uint8_t>& basis_states,
+ bool& has_contradiction,
+ Index starting_basis_pair,
+ Index ending_basis_pair,
+ int num_workers,
+ const ConsistencyOptions& options) {
+  if(num_workers < 2) {
+    // fallback to sequential solver if only one worker
+    return ensure_global_consistency(term_states,
+				     pair_states,
+				     basis_states,
+				     has_contradiction,
+				     starting_basis_pair,
+				     ending_basis_pair,
+				     options);
+  }
+  if(options.work_stealing) {
+    return stealing_parallel_ensure_global_consistency(term_states,
+						       pair_states,
+						       basis_states,
+						       has_contradiction,
+						       starting_basis_pair,
+						       ending_basis_pair,
+						       num_workers,
+						       options);
+  }
+  if(options.shared_state) {
+    return shared_parallel_ensure_global_consistency(term_states,
+						     pair_states,
+						     basis_states,
+						     has_contradiction,
+						     starting_basis_pair,
+						     ending_basis_pair,
+						     num_workers,
+						     options);
+  }
+  return copy_merge_parallel_ensure_global_consistency(term_states,
+						       pair_states,
+						       basis_states,
+						       has_contradiction,
+						       starting_basis_pair,
+						       ending_basis_pair,
+						       num_workers,
+						       options);
+}
+
+// the stealing and shared-state engines need byte stores
+template <typename TermStates, typename PairStates, typename BasisStates>
+static bool parallel_ensure_global_consistency_impl
+(TermStates& term_states,
+ PairStates& pair_states,
+ BasisStates& basis_states,
+ bool& has_contradiction,
+ Index starting_basis_pair,
+ Index ending_basis_pair,
+ int num_workers,
+ const ConsistencyOptions& options) {
+  if(num_workers < 2) {
+    return sequential_ensure_global_consistency(term_states,
+						pair_states,
+						basis_states,
+						has_contradiction,
+						starting_basis_pair,
+						ending_basis_pair,
+						options);
+  }
+  if(options.work_stealing || options.shared_state) {
+    throw std::invalid_argument("this state store only supports the "
+				"copy-and-merge parallel engine");
+  }
+  return copy_merge_parallel_ensure_global_consistency(term_states,
+						       pair_states,
+						       basis_states,
+						       has_contradiction,
+						       starting_basis_pair,
+						       ending_basis_pair,
+						       num_workers,
+						       options);
+}
+
+static bool parallel_ensure_global_consistency_impl
+(std::vector<uint8_t>& term_states,
+ std::vector<uint8_t>& pair_states,
+ std::vector<uint8_t>& basis_states,
+ bool& has_contradiction,
+ Index starting_basis_pair,
+ Index ending_basis_pair,
+ int num_workers,
+ const ConsistencyOptions& options) {
+  return parallel_ensure_global_consistency(term_states,
+					    pair_states,
+					    basis_states,
+					    has_contradiction,
+					    starting_basis_pair,
+					    ending_basis_pair,
+					    num_workers,
+					    options);
+}
+
+template <typename Store>
+bool parallel_ensure_global_consistency
+(Store& states,
+ bool& has_contradiction,
+ Index starting_basis_pair,
+ Index ending_basis_pair,
+ int num_workers,
+ const ConsistencyOptions& options) {
+  return parallel_ensure_global_consistency_impl(states.terms,
+						 states.pairs,
+						 states.bases,
+						 has_contradiction,
+						 starting_basis_pair,
+						 ending_basis_pair,
+						 num_workers,
+						 options);
+}
+
+#define INSTANTIATE_GLOBAL_CONSISTENCY(Store)			\
+  template bool ensure_global_consistency			\
+  (Store&, bool&, Index, Index, const ConsistencyOptions&);	\
+  template bool parallel_ensure_global_consistency		\
+  (Store&, bool&, Index, Index, int, const ConsistencyOptions&);
+FOR_EACH_STATE_STORE(INSTANTIATE_GLOBAL_CONSISTENCY)
+
+// Instance-parallel engine.  the states of batch_lanes() formulas
+// are interleaved so that the same state of every instance sits in
+// one vector; update_basis_states runs on all of them with one
+// LaneKernels::update_batch_basis and only the combination step goes
+// lane by lane.
+Index batch_lanes() {
+  return lane_kernels().batch_width;
+}
+
+// ensure_basis_consistency_pattern over every instance of the batch
+template <size_t P>
+static uint64_t ensure_batch_consistency_pattern(const BasisPair& bp,
+						 uint8_t* terms,
+						 uint8_t* pairs,
+						 uint8_t* bases,
+						 uint64_t& dead,
+						 uint64_t settled,
+						 CombineCache* cache) {
+  const LaneKernels& kernels = lane_kernels();
+  const Index W = kernels.batch_width;
+  constexpr const MergePattern& pattern = merge_pattern_tables.patterns[P];
+  constexpr size_t num_intermediaries = pattern.num_intermediaries;
+
+  // make the two bases consistent with their own pairs and terms
+  uint64_t changed = 0;
+  for (int pass = 0; pass < 3; pass++) {
+    changed |= (pass == 1) ?
+      kernels.update_batch_basis(bp.i2, bp.j2, bp.k2,
+				 bp.ij2_idx, bp.ik2_idx, bp.jk2_idx,
+				 bp.basis2_idx,
+				 terms, pairs, bases, dead) :
+      kernels.update_batch_basis(bp.i1, bp.j1, bp.k1,
+				 bp.ij1_idx, bp.ik1_idx, bp.jk1_idx,
+				 bp.basis1_idx,
+				 terms, pairs, bases, dead);
+  }
+
+  // the index arithmetic is shared by the whole batch
+  Index term[6], tri[6];
+  Index inter_idx[num_intermediaries];
+  intermediary_indices<P>(bp, term, tri, inter_idx);
+  uint64_t inter_changed;
+  do {
+    inter_changed = 0;
+    for (size_t idx = 0; idx < num_intermediaries; idx++) {
+      const size_t oa = pattern.offsets[idx][0];
+      const size_t ob = pattern.offsets[idx][1];
+      const size_t oc = pattern.offsets[idx][2];
+      inter_changed |=
+	kernels.update_batch_basis(term[oa], term[ob], term[oc],
+				   tri[ob] + term[oa],
+				   tri[oc] + term[oa],
+				   tri[oc] + term[ob],
+				   inter_idx[idx],
+				   terms, pairs, bases, dead);
+    }
+    changed |= inter_changed;
+  } while (inter_changed & ~dead);
+
+  // combine the bases of each live instance whose states moved since
+  // this basis pair last combined them
+  uint8_t* basis1 = bases + bp.basis1_idx * W;
+  uint8_t* basis2 = bases + bp.basis2_idx * W;
+  uint64_t combined = 0;
+  for (Index lane = 0; lane < W; lane++) {
+    if ((dead | (settled & ~changed)) & (uint64_t(1) << lane)) {
+      continue;
+    }
+    uint8_t inter_states[num_intermediaries];
+    uint8_t new_inter_states[num_intermediaries] = {0};
+    for (size_t i = 0; i < num_intermediaries; i++) {
+      inter_states[i] = bases[inter_idx[i] * W + lane];
+    }
+    uint8_t new_basis1_state = 0;
+    uint8_t new_basis2_state = 0;
+    combine_bases<P>(cache, basis1[lane], basis2[lane],
+		     inter_states, new_inter_states,
+		     new_basis1_state, new_basis2_state);
+    bool lane_changed = (basis1[lane] & new_basis1_state) != basis1[lane] ||
+      (basis2[lane] & new_basis2_state) != basis2[lane];
+    basis1[lane] &= new_basis1_state;
+    basis2[lane] &= new_basis2_state;
+    for (size_t i = 0; i < num_intermediaries; i++) {
+      uint8_t& state = bases[inter_idx[i] * W + lane];
+      lane_changed = lane_changed || (state & new_inter_states[i]) != state;
+      state &= new_inter_states[i];
+    }
+    if (lane_changed) {
+      combined |= uint64_t(1) << lane;
+    }
+  }
+  changed |= combined;
+  if (combined) {
+    // push the narrowed bases back down to their pairs and terms
+    changed |= kernels.update_batch_basis(bp.i1, bp.j1, bp.k1,
+					  bp.ij1_idx, bp.ik1_idx, bp.jk1_idx,
+					  bp.basis1_idx,
+					  terms, pairs, bases, dead);
+    changed |= kernels.update_batch_basis(bp.i2, bp.j2, bp.k2,
+					  bp.ij2_idx, bp.ik2_idx, bp.jk2_idx,
+					  bp.basis2_idx,
+					  terms, pairs, bases, dead);
+  }
+  return changed;
+}
+
+using BatchKernel = uint64_t (*)(const BasisPair&,
+				 uint8_t*, uint8_t*, uint8_t*, uint64_t&,
+				 uint64_t, CombineCache*);
+
+template <size_t... P>
+static constexpr std::array<BatchKernel, sizeof...(P)>
+make_batch_kernels(std::index_sequence<P...>) {
+  return {{ &ensure_batch_consistency_pattern<P>... }};
+}
+
+static constexpr std::array<BatchKernel, NUM_MERGE_PATTERNS> batch_kernels =
+  make_batch_kernels(std::make_index_sequence<NUM_MERGE_PATTERNS>());
+
+uint64_t batch_ensure_global_consistency(std::vector<uint8_t>& term_states,
+					 std::vector<uint8_t>& pair_states,
+					 std::vector<uint8_t>& basis_states,
+					 Index starting_basis_pair,
+					 Index ending_basis_pair,
+					 uint64_t dead) {
+  const Index W = batch_lanes();
+  const uint64_t all_lanes = (W == 64) ? ~uint64_t(0) :
+    (uint64_t(1) << W) - 1;
+  const Index num_basis_pairs = ending_basis_pair - starting_basis_pair;
+  // step of the last change to each lane over each term, at
+  // term * W + lane.  as in the small engine a lane none of whose
+  // terms changed since the previous visit of a basis pair is settled
+  // there, and a basis pair every lane is settled on is skipped.
+  std::vector<Index> changed_at(term_states.size(), 0);
+  Index step = 0;
+  uint64_t changed;
+  CombineCache* cache = thread_combine_cache();
+  Index until_poll = STOP_POLL_INTERVAL;
+  do {
+    changed = 0;
+    const bool first_pass = (step == 0);
+    for(BasisPairIterator it(starting_basis_pair);
+	it.basis_pair() < ending_basis_pair;
+	it.next(), step++) {
+      const BasisPair& bp = it.current();
+      const Index terms_touched[6] = {bp.i1, bp.j1, bp.k1,
+				      bp.i2, bp.j2, bp.k2};
+      uint64_t settled = 0;
+      if (!first_pass) {
+	for (Index lane = 0; lane < W; lane++) {
+	  Index last_change = 0;
+	  for (Index term : terms_touched) {
+	    last_change = std::max(last_change, changed_at[term * W + lane]);
+	  }
+	  if (last_change + num_basis_pairs <= step) {
+	    settled |= uint64_t(1) << lane;
+	  }
+	}
+	if (((settled | dead) & all_lanes) == all_lanes) {
+	  continue;
+	}
+      }
+      // nothing left to learn once every lane has a contradiction
+      if ((dead & all_lanes) == all_lanes) {
+	return dead;
+      }
+      if (--until_poll == 0) {
+	until_poll = STOP_POLL_INTERVAL;
+	if (engine_should_stop(nullptr)) {
+	  return dead;
+	}
+      }
+      uint64_t pair_changed =
+	batch_kernels[classify_basis_pair(bp)](bp,
+					       term_states.data(),
+					       pair_states.data(),
+					       basis_states.data(),
+					       dead, settled, cache);
+      pair_changed &= ~dead;
+      changed |= pair_changed;
+      for (Index lane = 0; pair_changed; lane++, pair_changed >>= 1) {
+	if (pair_changed & 1) {
+	  for (Index term : terms_touched) {
+	    changed_at[term * W + lane] = step + 1;
+	  }
+	}
+      }
+    }
+  } while ((changed & ~dead) && !engine_should_stop(nullptr));
+  return dead;
+}
+
+// Small engine.  a formula of at most N terms is solved in a
+// SmallStateStore on the caller's stack, and the terms and pair
+// indices of every basis come from a table built at compile time, so
+// a sweep does no allocation and no unpairing.  the bases of the first
+// n <= N terms are a prefix of the colex order, so one table per N
+// serves every smaller formula.
+//
+// the terms also make for a cheap worklist: a basis pair only reads
+// and writes states over its own six terms, so it can be skipped if
+// none of those terms saw a change since its visit in the previous
+// pass.  running it again could not change anything.
+template <Index N>
+struct SmallTables {
+  static constexpr Index NUM_PAIRS = N * (N - 1) / 2;
+  static constexpr Index NUM_BASES = N * (N - 1) * (N - 2) / 6;
+  // terms (i,j,k) of basis b and the indices of (i,j), (i,k), (j,k)
+  uint8_t terms[NUM_BASES][3];
+  uint16_t pairs[NUM_BASES][3];
+};
+
+template <Index N>
+static constexpr SmallTables<N> build_small_tables() {
+  SmallTables<N> tables{};
+  Index basis = 0;
+  for (Index k = 2; k < N; k++) {
+    for (Index j = 1; j < k; j++) {
+      for (Index i = 0; i < j; i++, basis++) {
+	tables.terms[basis][0] = i;
+	tables.terms[basis][1] = j;
+	tables.terms[basis][2] = k;
+	tables.pairs[basis][0] = (j * (j - 1)) / 2 + i;
+	tables.pairs[basis][1] = (k * (k - 1)) / 2 + i;
+	tables.pairs[basis][2] = (k * (k - 1)) / 2 + j;
+      }
+    }
+  }
+  return tables;
+}
+
+template <Index N>
+static constexpr SmallTables<N> small_tables = build_small_tables<N>();
+
+// fill one side of a BasisPair from the table
+template <Index N>
+static inline void small_basis(Index basis,
+			       Index& idx, Index& i, Index& j, Index& k,
+			       Index& ij_idx, Index& ik_idx, Index& jk_idx) {
+  const SmallTables<N>& tables = small_tables<N>;
+  idx = basis;
+  i = tables.terms[basis][0];
+  j = tables.terms[basis][1];
+  k = tables.terms[basis][2];
+  ij_idx = tables.pairs[basis][0];
+  ik_idx = tables.pairs[basis][1];
+  jk_idx = tables.pairs[basis][2];
+}
+
+// sweep_basis_pairs over every basis pair of the formula, in place
+// on its fixed size levels.  after the first pass only the basis pairs
+// with a term changed since their previous visit are run.
+template <Index N>
+static bool small_global_consistency(SmallStateStore& states,
+				     bool& has_contradiction) {
+  uint8_t* terms = states.terms.data();
+  uint8_t* pairs = states.pairs.data();
+  uint8_t* bases = states.bases.data();
+  const Index num_bases = states.bases.size();
+  const Index num_basis_pairs = (num_bases * (num_bases - 1)) / 2;
+
+  // step of the last change to a state over each term, counting basis
+  // pair visits over all passes
+  Index changed_at[N] = {0};
+  Index step = 0;
+  CombineCache* cache = thread_combine_cache();
+  has_contradiction = false;
+  bool changed = true;
+  bool globally_changed = false;
+  Index until_poll = STOP_POLL_INTERVAL;
+  while (changed && !has_contradiction) {
+    changed = false;
+    const bool first_pass = (step == 0);
+    BasisPair bp;
+    for (Index basis2 = 1; basis2 < num_bases; basis2++) {
+      small_basis<N>(basis2, bp.basis2_idx, bp.i2, bp.j2, bp.k2,
+		     bp.ij2_idx, bp.ik2_idx, bp.jk2_idx);
+      Index changed2 = std::max({changed_at[bp.i2], changed_at[bp.j2],
+				 changed_at[bp.k2]});
+      Index basis1 = 0;
+      for (; basis1 < basis2; basis1++, step++) {
+	small_basis<N>(basis1, bp.basis1_idx, bp.i1, bp.j1, bp.k1,
+		       bp.ij1_idx, bp.ik1_idx, bp.jk1_idx);
+	if (!first_pass &&
+	    std::max({changed2, changed_at[bp.i1], changed_at[bp.j1],
+		      changed_at[bp.k1]}) + num_basis_pairs <= step) {
+	  continue;
+	}
+	if (--until_poll == 0) {
+	  until_poll = STOP_POLL_INTERVAL;
+	  if (engine_should_stop(nullptr)) {
+	    // a pass cut short reports no change
+	    changed = false;
+	    break;
+	  }
+	}
+	UpdateResult result =
+	  pattern_kernels<false, uint8_t*>[classify_basis_pair(bp)]
+	  (bp, terms, pairs, bases, cache);
+	if (result.has_zero) {
+	  has_contradiction = true;
+	  break;
+	}
+	if (result.changed) {
+	  changed = true;
+	  const Index terms_touched[6] = {bp.i1, bp.j1, bp.k1,
+					  bp.i2, bp.j2, bp.k2};
+	  for (Index term : terms_touched) {
+	    changed_at[term] = step + 1;
+	  }
+	  changed2 = step + 1;
+	}
+      }
+      if (basis1 < basis2) {
+	break;
+      }
+    }
+    globally_changed = globally_changed || changed || has_contradiction;
+  }
+  return globally_changed;
+}
+
+bool small_ensure_global_consistency(SmallStateStore& states,
+				     bool& has_contradiction) {
+  const Index n = states.num_terms();
+  if (n <= 16) {
+    return small_global_consistency<16>(states, has_contradiction);
+  }
+  if (n <= 32) {
+    return small_global_consistency<32>(states, has_contradiction);
+  }
+  return small_global_consistency<64>(states, has_contradiction);
 }
@@ -23,9 +23,11 @@
 #pragma once
 #include <cstdint>
 #include <vector>
+#include <string>
 #include <tuple>
 #include "constants.h"
 #include "pairing.h"
+#include "state_store.h"
 
 // Result structure for state updates
 struct UpdateResult {
@@ -39,28 +41,161 @@ struct UpdateResult {
     bool any() const { return changed || has_zero; }
 };
 
+// Tunables for the global consistency engine
+struct ConsistencyOptions {
+    // Only revisit basis pairs whose terms, pairs or bases changed
+    // during the previous pass
+    bool use_worklist;
+    // Parallel workers prune one shared store with atomic ANDs
+    // instead of copying the states and merging them afterwards.
+    // ignores use_worklist.
+    bool shared_state;
+    // Cut the basis pair range into tasks of task_size basis pairs
+    // that idle workers steal from busy ones
+    bool work_stealing;
+    Index task_size;
+    // Drive the parallel engines from one persistent pool of pinned
+    // threads instead of spawning threads every iteration
+    bool use_pool;
+    // Stop the engine once this many milliseconds have passed since
+    // the solve started.  0 means no deadline.
+    uint64_t timeout_ms;
+    // Skip basis pairs whose six terms are all still unconstrained.
+    // used by the sequential and copy-and-merge engines.
+    bool skip_unconstrained;
+    // Sweep the basis pairs in tile_size x tile_size tiles of
+    // (basis1, basis2) so each tile's states stay in cache.  0 walks
+    // them in index order.  the worklist engine ignores it.
+    Index tile_size;
+    // Cut the largest terms of both bases into ranges of tile_terms
+    // terms instead, so a tile reads whole slabs of basis_states in
+    // order and a pass reports its progress in tiles.  meant for a
+    // basis_states that is paged from spill_dir.  takes precedence
+    // over tile_size.
+    Index tile_terms;
+    // Run the O(n^3) sweep_basis_rows to a fixpoint before every
+    // full basis pair sweep.  only when the range runs to the last
+    // basis pair, and ignored by the worklist engine.
+    bool row_propagation;
+    // Let check_satisfiability hand formulas of at most
+    // SMALL_ENGINE_MAX_TERMS terms to small_ensure_global_consistency
+    // when no other engine option is asked for
+    bool small_engine;
+    // Keep basis_states in a ZeroPageStates instead of a
+    // std::vector so only the pages of restricted bases get
+    // committed (a ZeroPageStateStore).  the sequential and
+    // copy-and-merge engines only, without the worklist,
+    // skip_unconstrained or row_propagation.
+    bool zero_page_states;
+    // Store check_satisfiability solves in.  the packed backends have
+    // the same restrictions as zero_page_states.
+    StateBackend state_backend;
+    // With zero_page_states, back the basis states with an unlinked
+    // sparse file in this directory instead of anonymous memory, so
+    // the kernel can write them out and drop them under memory
+    // pressure rather than kill us.  empty for anonymous memory.
+    std::string spill_dir;
+    // Peak bytes check_satisfiability plans the solve to fit in (see
+    // memory_budget.h).  0 uses the cgroup limit, if there is one.
+    size_t max_memory;
+
+    ConsistencyOptions()
+        : use_worklist(false), shared_state(false),
+          work_stealing(false), task_size(4096), use_pool(false),
+          timeout_ms(0), skip_unconstrained(false), tile_size(0),
+          tile_terms(0), row_propagation(false), small_engine(true),
+          zero_page_states(false), state_backend(StateBackend::DENSE),
+          max_memory(0) {}
+};
+
+// How ensure_basis_consistency combines the states of two bases.
+// SCALAR walks the up to 64 state combinations one at a time,
+// BITSLICED evaluates all of them at once in the bits of one word.
+// both give identical results.
+enum class BasisKernel {
+    SCALAR,
+    BITSLICED
+};
+
+void set_basis_kernel(BasisKernel kernel);
+BasisKernel basis_kernel();
+
+// Memoize the basis combination step.  its result depends only on the
+// interleaving of the two bases and the states going in, so each
+// thread keeps a direct mapped cache of entries outcomes keyed on
+// those (rounded up to a power of two, 0 turns the cache off).
+void set_combine_cache(size_t entries);
+
+// Bytes of the combine cache each thread that sweeps keeps
+size_t combine_cache_bytes();
+
+struct CombineCacheStats {
+    uint64_t lookups;
+    uint64_t hits;
+};
+
+// Totals over every thread since the last reset
+CombineCacheStats combine_cache_stats();
+void reset_combine_cache_stats();
+
+// Why the engine gave up before reaching a fixpoint
+enum class StopReason {
+    NONE,
+    DEADLINE,
+    INTERRUPT
+};
+
+// Arm the deadline for the next solve, timeout_ms from now (0 for
+// none).  clears an earlier DEADLINE stop but keeps an INTERRUPT.
+void arm_engine_deadline(uint64_t timeout_ms);
+
+// Ask every running sweep to stop at its next poll.  only touches a
+// lock free atomic so it is safe to call from a signal handler.
+void request_engine_stop(StopReason reason);
+
+// NONE unless the engine was stopped by a deadline or an interrupt,
+// in which case its results are sound but incomplete
+StopReason engine_stop_reason();
+
 std::string term_state_str(uint8_t state);
 std::string pair_state_str(uint8_t state);
 std::string basis_state_str(uint8_t state);
 
+// The state arguments of update_pair_states and update_basis_states
+// are the levels of a StateStore (see state_store.h), they are
+// instantiated for those of every store FOR_EACH_STATE_STORE names
+
 // update pair and term states to maintain consistency
+template <typename TermStates, typename PairStates>
 UpdateResult update_pair_states(Index i, Index j,
-				std::vector<uint8_t>& term_states,
-				std::vector<uint8_t>& pair_states);
+				TermStates& term_states,
+				PairStates& pair_states);
 
 // Update basis, pair, and term states to maintain consistency
 // Returns detailed result about what happened during update
+template <typename TermStates, typename PairStates, typename BasisStates>
 UpdateResult update_basis_states(Index i, Index j, Index k,
 				 Index basis_idx,
-				 std::vector<uint8_t>& term_states,
-				 std::vector<uint8_t>& pair_states,
-				 std::vector<uint8_t>& basis_states);
+				 TermStates& term_states,
+				 PairStates& pair_states,
+				 BasisStates& basis_states);
 
-UpdateResult ensure_basis_consistency(
-    Index basis1_idx, Index basis2_idx, 
-    std::vector<uint8_t>& term_states,
-    std::vector<uint8_t>& pair_states,
-    std::vector<uint8_t>& basis_states);
+
+// Same as above for callers that already know the pair indices of
+// (i,j), (i,k) and (j,k)
+template <typename TermStates, typename PairStates, typename BasisStates>
+UpdateResult update_basis_states(Index i, Index j, Index k,
+				 Index ij_idx, Index ik_idx, Index jk_idx,
+				 Index basis_idx,
+				 TermStates& term_states,
+				 PairStates& pair_states,
+				 BasisStates& basis_states);
+
+// Make two bases and their intermediaries consistent with each other
+UpdateResult ensure_basis_consistency(const BasisPair& bp,
+				      std::vector<uint8_t>& term_states,
+				      std::vector<uint8_t>& pair_states,
+				      std::vector<uint8_t>& basis_states);
 
 // Ensure consistency across all bases in the system
 bool ensure_global_consistency(std::vector<uint8_t>& term_states,
@@ -68,7 +203,52 @@ bool ensure_global_consistency(std::vector<uint8_t>& term_states,
 			       std::vector<uint8_t>& basis_states,
 			       bool& has_contradiction,
 			       Index starting_basis_pair,
-			       Index ending_basis_pair);
+			       Index ending_basis_pair,
+			       const ConsistencyOptions& options =
+			       ConsistencyOptions());
+
+// Same on a StateStore.  a DenseStateStore gets every engine, the
+// other stores the plain and tiled sweeps and, in parallel, the
+// copy-and-merge engine.  they throw std::invalid_argument for the
+// other options.
+template <typename Store>
+bool ensure_global_consistency(Store& states,
+			       bool& has_contradiction,
+			       Index starting_basis_pair,
+			       Index ending_basis_pair,
+			       const ConsistencyOptions& options =
+			       ConsistencyOptions());
+
+// Largest formula, in terms after clause splitting, the small engine
+// takes
+constexpr Index SMALL_ENGINE_MAX_TERMS = 64;
+
+// ensure_global_consistency over every basis pair, for formulas of at
+// most SMALL_ENGINE_MAX_TERMS terms.  runs in place on the
+// stack-resident store and takes the basis terms and pair indices
+// from compile time tables for 16, 32 or 64 terms.
+bool small_ensure_global_consistency(SmallStateStore& states,
+				     bool& has_contradiction);
+
+// Number of formulas the instance-parallel engine runs in lockstep,
+// one per SIMD lane of the active cpu_level()
+Index batch_lanes();
+
+// ensure_global_consistency on batch_lanes() formulas over the same
+// variables at once.  the arrays hold every instance's states
+// interleaved, state x of instance l at x * batch_lanes() + l.  the
+// sweep, the index arithmetic and update_basis_states are shared by
+// the whole batch.  dead has a bit set for each lane to leave out,
+// one already refuted or holding no formula.  returns dead with bit l
+// also set if instance l ran into a contradiction, as soon as every
+// lane is dead.  after an engine stop the lanes not in the mask prove
+// nothing, callers check engine_stop_reason().
+uint64_t batch_ensure_global_consistency(std::vector<uint8_t>& term_states,
+					 std::vector<uint8_t>& pair_states,
+					 std::vector<uint8_t>& basis_states,
+					 Index starting_basis_pair,
+					 Index ending_basis_pair,
+					 uint64_t dead = 0);
 
 bool parallel_ensure_global_consistency
 (std::vector<uint8_t>& term_states,
@@ -77,5 +257,15 @@ bool parallel_ensure_global_consistency
  bool& has_contradiction,
  Index starting_basis_pair,
  Index ending_basis_pair,
- int num_workers);
+ int num_workers,
+ const ConsistencyOptions& options = ConsistencyOptions());
+
+template <typename Store>
+bool parallel_ensure_global_consistency
+(Store& states,
+ bool& has_contradiction,
+ Index starting_basis_pair,
+ Index ending_basis_pair,
+ int num_workers,
+ const ConsistencyOptions& options = ConsistencyOptions());
 
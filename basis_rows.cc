@@ -0,0 +1,332 @@
+// MIT License
+
+// Copyright (c) 2025 Daniel Issen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "basis_rows.h"
+#include "basis_consistency.h"
+#include "constants.h"
+#include "bit_planes.h"
+#include "lane_kernels.h"
+#include <algorithm>
+
+// Bit-sliced copies of the states, one bit-plane per state bit
+struct SlicedStates {
+  BitPlanes<2> terms;
+  BitPlanes<4> pairs;
+  BitPlanes<8> bases;
+};
+
+// The shared states of a row as bit-planes, each bit broadcast to a
+// whole word
+struct SlicedRow {
+  uint64_t term_j[2];
+  uint64_t term_k[2];
+  uint64_t pair_jk[4];
+};
+
+static inline uint64_t spread(bool bit) {
+  return bit ? ~uint64_t(0) : 0;
+}
+
+// true when every lane of a plane word is set
+static inline bool all_lanes(uint64_t word, uint64_t lanes) {
+  return (word | ~lanes) == ~uint64_t(0);
+}
+
+// The row update of LaneKernels::sweep_rows on the count <= 64 bases
+// (i,j,k) from i on, with the rules written out over the bit-planes.  a bit a, b or c is the
+// value of term i, j or k.
+static bool update_sliced_chunk(SlicedStates& states,
+				Index i, Index count,
+				Index ij_start, Index ik_start,
+				Index basis_start,
+				SlicedRow& row,
+				bool& changed) {
+  const uint64_t lanes = (count == 64) ? ~uint64_t(0) :
+    (uint64_t(1) << count) - 1;
+  uint64_t term_i[2], pair_ij[4], pair_ik[4], basis[8];
+  for (int a = 0; a < 2; a++) {
+    term_i[a] = states.terms.load(a, i);
+  }
+  for (int p = 0; p < 4; p++) {
+    pair_ij[p] = states.pairs.load(p, ij_start + i);
+    pair_ik[p] = states.pairs.load(p, ik_start + i);
+  }
+  for (int v = 0; v < 8; v++) {
+    basis[v] = states.bases.load(v, basis_start + i);
+  }
+
+  // terms -> pairs -> basis
+  uint64_t new_ij[4], new_ik[4], lane_jk[4], new_basis[8];
+  for (int x = 0; x < 2; x++) {
+    for (int y = 0; y < 2; y++) {
+      new_ij[x * 2 + y] = pair_ij[x * 2 + y] & term_i[x] & row.term_j[y];
+      new_ik[x * 2 + y] = pair_ik[x * 2 + y] & term_i[x] & row.term_k[y];
+      lane_jk[x * 2 + y] = row.pair_jk[x * 2 + y] &
+	row.term_j[x] & row.term_k[y];
+    }
+  }
+  for (int a = 0; a < 2; a++) {
+    for (int b = 0; b < 2; b++) {
+      for (int c = 0; c < 2; c++) {
+	new_basis[a * 4 + b * 2 + c] = basis[a * 4 + b * 2 + c] &
+	  term_i[a] & row.term_j[b] & row.term_k[c] &
+	  new_ij[a * 2 + b] & new_ik[a * 2 + c] & lane_jk[b * 2 + c];
+      }
+    }
+  }
+
+  // basis -> pairs -> terms
+  for (int x = 0; x < 2; x++) {
+    for (int y = 0; y < 2; y++) {
+      new_ij[x * 2 + y] &= new_basis[x * 4 + y * 2] |
+	new_basis[x * 4 + y * 2 + 1];
+      new_ik[x * 2 + y] &= new_basis[x * 4 + y] | new_basis[x * 4 + 2 + y];
+      lane_jk[x * 2 + y] &= new_basis[x * 2 + y] | new_basis[4 + x * 2 + y];
+    }
+  }
+  uint64_t new_i[2];
+  SlicedRow reduced;
+  for (int x = 0; x < 2; x++) {
+    new_i[x] = term_i[x] & (new_ij[x * 2] | new_ij[x * 2 + 1] |
+			    new_ik[x * 2] | new_ik[x * 2 + 1]);
+    reduced.term_j[x] =
+      spread(all_lanes(row.term_j[x] &
+		       (new_ij[x] | new_ij[2 + x] |
+			lane_jk[x * 2] | lane_jk[x * 2 + 1]), lanes));
+    reduced.term_k[x] =
+      spread(all_lanes(row.term_k[x] &
+		       (new_ik[x] | new_ik[2 + x] |
+			lane_jk[x] | lane_jk[2 + x]), lanes));
+  }
+  for (int p = 0; p < 4; p++) {
+    reduced.pair_jk[p] = spread(all_lanes(lane_jk[p], lanes));
+  }
+
+  // write back, look for changes and zero states
+  uint64_t diff = 0;
+  uint64_t any_i = 0, any_ij = 0, any_ik = 0, any_basis = 0;
+  for (int a = 0; a < 2; a++) {
+    states.terms.narrow(a, i, new_i[a], lanes);
+    diff |= term_i[a] ^ new_i[a];
+    any_i |= new_i[a];
+  }
+  for (int p = 0; p < 4; p++) {
+    states.pairs.narrow(p, ij_start + i, new_ij[p], lanes);
+    states.pairs.narrow(p, ik_start + i, new_ik[p], lanes);
+    diff |= (pair_ij[p] ^ new_ij[p]) | (pair_ik[p] ^ new_ik[p]);
+    any_ij |= new_ij[p];
+    any_ik |= new_ik[p];
+  }
+  for (int v = 0; v < 8; v++) {
+    states.bases.narrow(v, basis_start + i, new_basis[v], lanes);
+    diff |= basis[v] ^ new_basis[v];
+    any_basis |= new_basis[v];
+  }
+  uint64_t shared_j = 0, shared_k = 0, shared_jk = 0;
+  for (int x = 0; x < 2; x++) {
+    diff |= (reduced.term_j[x] ^ row.term_j[x]) |
+      (reduced.term_k[x] ^ row.term_k[x]);
+    shared_j |= reduced.term_j[x];
+    shared_k |= reduced.term_k[x];
+  }
+  for (int p = 0; p < 4; p++) {
+    diff |= reduced.pair_jk[p] ^ row.pair_jk[p];
+    shared_jk |= reduced.pair_jk[p];
+  }
+  changed = changed || (diff & lanes);
+  row = reduced;
+  return all_lanes(any_i, lanes) && all_lanes(any_ij, lanes) &&
+    all_lanes(any_ik, lanes) && all_lanes(any_basis, lanes) &&
+    shared_j && shared_k && shared_jk;
+}
+
+// LaneKernels::sweep_rows over bit-sliced states
+static bool sweep_sliced_rows_once(SlicedStates& states,
+				   Index starting_basis,
+				   bool& changed) {
+  const Index n = states.terms.size();
+  Index i0, j0, k0;
+  std::tie(i0, j0, k0) = unpair3d(starting_basis);
+  for (Index k = k0; k < n; k++) {
+    for (Index j = (k == k0 ? j0 : 1); j < k; j++) {
+      const Index ij_start = pair2d(0, j);
+      const Index ik_start = pair2d(0, k);
+      const Index jk_idx = pair2d(j, k);
+      const Index basis_start = pair3d(0, j, k);
+      SlicedRow row;
+      for (int x = 0; x < 2; x++) {
+	row.term_j[x] = spread(states.terms.test(x, j));
+	row.term_k[x] = spread(states.terms.test(x, k));
+      }
+      for (int p = 0; p < 4; p++) {
+	row.pair_jk[p] = spread(states.pairs.test(p, jk_idx));
+      }
+      bool ok = true;
+      for (Index i = (k == k0 && j == j0) ? i0 : 0; ok && i < j; i += 64) {
+	ok = update_sliced_chunk(states, i, std::min<Index>(64, j - i),
+				 ij_start, ik_start, basis_start,
+				 row, changed);
+      }
+      for (int x = 0; x < 2; x++) {
+	states.terms.narrow(x, j, row.term_j[x], 1);
+	states.terms.narrow(x, k, row.term_k[x], 1);
+      }
+      for (int p = 0; p < 4; p++) {
+	states.pairs.narrow(p, jk_idx, row.pair_jk[p], 1);
+      }
+      if (!ok) {
+	return false;
+      }
+    }
+  }
+  return true;
+}
+
+static RowStorage active_row_storage = RowStorage::BYTES;
+
+void set_row_storage(RowStorage storage) {
+  active_row_storage = storage;
+}
+
+RowStorage row_storage() {
+  return active_row_storage;
+}
+
+// sweep_basis_rows one basis at a time, for stores the row kernels
+// cannot run on
+template <typename TermStates, typename PairStates, typename BasisStates>
+static bool sweep_bases_one_at_a_time(TermStates& term_states,
+				      PairStates& pair_states,
+				      BasisStates& basis_states,
+				      bool& has_contradiction,
+				      Index starting_basis) {
+  has_contradiction = false;
+  bool globally_changed = false;
+  bool changed;
+  do {
+    changed = false;
+    Index i, j, k;
+    std::tie(i, j, k) = unpair3d(starting_basis);
+    Index ij_idx = pair2d(i, j);
+    Index ik_idx = pair2d(i, k);
+    Index jk_idx = pair2d(j, k);
+    for (Index basis_idx = starting_basis;
+	 basis_idx < basis_states.size();
+	 ++basis_idx,
+	   BasisPairIterator::advance_basis(i, j, k,
+					    ij_idx, ik_idx, jk_idx)) {
+      UpdateResult result = update_basis_states(i, j, k,
+						ij_idx, ik_idx, jk_idx,
+						basis_idx,
+						term_states,
+						pair_states,
+						basis_states);
+      if (result.has_zero) {
+	has_contradiction = true;
+	return true;
+      }
+      changed = changed || result.changed;
+    }
+    globally_changed = globally_changed || changed;
+  } while (changed);
+  return globally_changed;
+}
+
+bool sweep_basis_rows(std::vector<uint8_t>& term_states,
+		      std::vector<uint8_t>& pair_states,
+		      std::vector<uint8_t>& basis_states,
+		      bool& has_contradiction,
+		      Index starting_basis) {
+  has_contradiction = false;
+  bool globally_changed = false;
+  if (starting_basis >= basis_states.size()) {
+    return false;
+  }
+  bool changed;
+  if (active_row_storage == RowStorage::BITSLICED) {
+    SlicedStates states = {BitPlanes<2>(term_states),
+			   BitPlanes<4>(pair_states),
+			   BitPlanes<8>(basis_states)};
+    do {
+      changed = false;
+      if (!sweep_sliced_rows_once(states, starting_basis, changed)) {
+	has_contradiction = true;
+	globally_changed = true;
+	break;
+      }
+      globally_changed = globally_changed || changed;
+    } while (changed);
+    states.terms.unpack(term_states);
+    states.pairs.unpack(pair_states);
+    states.bases.unpack(basis_states);
+    return globally_changed;
+  }
+  const LaneKernels& kernels = lane_kernels();
+  Index i0, j0, k0;
+  std::tie(i0, j0, k0) = unpair3d(starting_basis);
+  do {
+    changed = false;
+    if (!kernels.sweep_rows(term_states.data(), pair_states.data(),
+			    basis_states.data(), term_states.size(),
+			    i0, j0, k0, changed)) {
+      has_contradiction = true;
+      return true;
+    }
+    globally_changed = globally_changed || changed;
+  } while (changed);
+  return globally_changed;
+}
+
+template <typename TermStates, typename PairStates, typename BasisStates>
+static bool sweep_basis_rows_impl(TermStates& term_states,
+				  PairStates& pair_states,
+				  BasisStates& basis_states,
+				  bool& has_contradiction,
+				  Index starting_basis) {
+  has_contradiction = false;
+  if (starting_basis >= basis_states.size()) {
+    return false;
+  }
+  return sweep_bases_one_at_a_time(term_states, pair_states, basis_states,
+				   has_contradiction, starting_basis);
+}
+
+static bool sweep_basis_rows_impl(std::vector<uint8_t>& term_states,
+				  std::vector<uint8_t>& pair_states,
+				  std::vector<uint8_t>& basis_states,
+				  bool& has_contradiction,
+				  Index starting_basis) {
+  return sweep_basis_rows(term_states, pair_states, basis_states,
+			  has_contradiction, starting_basis);
+}
+
+template <typename Store>
+bool sweep_basis_rows(Store& states,
+		      bool& has_contradiction,
+		      Index starting_basis) {
+  return sweep_basis_rows_impl(states.terms, states.pairs, states.bases,
+			       has_contradiction, starting_basis);
+}
+
+#define INSTANTIATE_SWEEP_BASIS_ROWS(Store)			\
+  template bool sweep_basis_rows(Store&, bool&, Index);
+FOR_EACH_STATE_STORE(INSTANTIATE_SWEEP_BASIS_ROWS)
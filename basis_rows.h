@@ -0,0 +1,68 @@
+// MIT License
+
+// Copyright (c) 2025 Daniel Issen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// O(n^3) propagation between terms, pairs and bases.  runs the
+// update_basis_states rule over every basis until nothing changes,
+// without looking at pairs of bases.  it is the cheap level between
+// two full O(n^6) basis pair sweeps and the per-basis pass of
+// determine_solution.
+//
+// In colex order the bases (i,j,k) of a fixed (j,k) form a row
+// of j consecutive bytes of basis_states, and so do their terms i and
+// their pairs (i,j) and (i,k).  a row is updated with byte shuffles
+// as the table lookups, so one instruction handles 16 or 32 bases,
+// and the shared term j, term k and pair (j,k) are reduced back with
+// an AND over the row.
+
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "pairing.h"
+#include "state_store.h"
+
+// How sweep_basis_rows holds the states while it works.  BYTES
+// updates the byte arrays in place, 16 or 32 bases per shuffle.
+// BITSLICED copies them into bit-planes (see bit_planes.h), runs on
+// 64 bases per word and copies them back.  both give identical
+// results.
+enum class RowStorage { BYTES, BITSLICED };
+
+void set_row_storage(RowStorage storage);
+RowStorage row_storage();
+
+// Run update_basis_states over every basis from starting_basis on
+// until nothing changes.  reaches the same fixpoint as repeated
+// per-basis passes in pair3d order.  sets has_contradiction and
+// stops as soon as a state goes to zero.  returns true if any state
+// changed.
+bool sweep_basis_rows(std::vector<uint8_t>& term_states,
+		      std::vector<uint8_t>& pair_states,
+		      std::vector<uint8_t>& basis_states,
+		      bool& has_contradiction,
+		      Index starting_basis = 0);
+
+// Same on a StateStore.  the row kernels only read byte arrays, so
+// stores other than DenseStateStore go one basis at a time.
+template <typename Store>
+bool sweep_basis_rows(Store& states,
+		      bool& has_contradiction,
+		      Index starting_basis = 0);
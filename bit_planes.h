@@ -0,0 +1,98 @@
+// MIT License
+
+// Copyright (c) 2025 Daniel Issen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Bit-sliced storage for term, pair and basis states.  a state of
+// Bits bits is spread over Bits bit-planes: bit v of state x lives in
+// bit x % 64 of word x / 64 of plane v.  one word of a plane then
+// holds bit v of 64 consecutive states, so clearing an assignment,
+// checking for zero states or for changes over 64 states at once is a
+// handful of word-wide boolean operations.
+
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "pairing.h"
+
+template <int Bits>
+class BitPlanes {
+public:
+  // Slice byte states, one per state
+  explicit BitPlanes(const std::vector<uint8_t>& states)
+    : size_(states.size()) {
+    // one spare word so a 64 state window never runs off the end
+    Index num_words = size_ / 64 + 2;
+    for (int v = 0; v < Bits; v++) {
+      planes_[v].assign(num_words, 0);
+    }
+    for (Index x = 0; x < size_; x++) {
+      for (int v = 0; v < Bits; v++) {
+	planes_[v][x >> 6] |= uint64_t((states[x] >> v) & 1) << (x & 63);
+      }
+    }
+  }
+
+  // Write the states back as one byte per state
+  void unpack(std::vector<uint8_t>& states) const {
+    states.resize(size_);
+    for (Index x = 0; x < size_; x++) {
+      uint8_t state = 0;
+      for (int v = 0; v < Bits; v++) {
+	state |= ((planes_[v][x >> 6] >> (x & 63)) & 1) << v;
+      }
+      states[x] = state;
+    }
+  }
+
+  Index size() const { return size_; }
+
+  // Bit v of the 64 states starting at pos
+  uint64_t load(int v, Index pos) const {
+    const uint64_t* words = &planes_[v][pos >> 6];
+    unsigned shift = pos & 63;
+    if (!shift) {
+      return words[0];
+    }
+    return (words[0] >> shift) | (words[1] << (64 - shift));
+  }
+
+  // Clear bit v of the states from pos on that are set in lanes but
+  // not in allowed.  states only ever lose bits, so this is the only
+  // store needed.
+  void narrow(int v, Index pos, uint64_t allowed, uint64_t lanes) {
+    uint64_t cleared = ~allowed & lanes;
+    uint64_t* words = &planes_[v][pos >> 6];
+    unsigned shift = pos & 63;
+    words[0] &= ~(cleared << shift);
+    if (shift) {
+      words[1] &= ~(cleared >> (64 - shift));
+    }
+  }
+
+  // Bit v of state x
+  bool test(int v, Index x) const {
+    return (planes_[v][x >> 6] >> (x & 63)) & 1;
+  }
+
+private:
+  Index size_;
+  std::vector<uint64_t> planes_[Bits];
+};
@@ -23,9 +23,55 @@
 #include <iostream>
 #include <string>
 #include <stdexcept>
+#include <csignal>
+#include <cctype>
 #include "file_parser.h"
 #include "cnf_solver.h"
 #include "test_utils.h"
+#include "basis_rows.h"
+#include "cpu_features.h"
+#include "memory_budget.h"
+#include "huge_pages.h"
+#include <unistd.h>
+
+// Hand the run to the 128 bit Index build when this one cannot index
+// the formula.  make index-variants puts cnf_3sat_solver_i128 next to
+// cnf_3sat_solver and cnf_3sat_solver_i32, so the sibling is found
+// from our own executable rather than from argv[0], which has no
+// directory when we were found on the PATH.  only returns if there is
+// no such build.
+static void exec_wider_build(char* argv[]) {
+#if INDEX_BITS < 128
+  std::string self;
+  char path[4096];
+  ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+  if (length > 0) {
+    self.assign(path, length);
+  } else {
+    self = argv[0];
+  }
+  const std::string narrow_suffix = "_i" + std::to_string(INDEX_BITS);
+  if (self.size() > narrow_suffix.size() &&
+      self.compare(self.size() - narrow_suffix.size(), narrow_suffix.size(),
+                   narrow_suffix) == 0) {
+    self.erase(self.size() - narrow_suffix.size());
+  }
+  std::string wider = self + "_i128";
+  if (access(wider.c_str(), X_OK) == 0) {
+    std::cout << "Formula too large for " << INDEX_BITS
+              << " bit indices, switching to " << wider << std::endl;
+    execv(wider.c_str(), argv);
+  }
+#else
+  (void)argv;
+#endif
+}
+
+// First ctrl-c stops the engine cleanly, a second one kills us
+static void handle_interrupt(int) {
+  request_engine_stop(StopReason::INTERRUPT);
+  std::signal(SIGINT, SIG_DFL);
+}
 
 // Modified main function in cnf_3sat_solver_main.cc
 int main(int argc, char* argv[]) {
@@ -42,6 +88,20 @@ int main(int argc, char* argv[]) {
   int test_clauses = 20;
   int max_literals = 3;
   int num_workers = 1;  // Default to sequential execution
+  bool run_layout_bench = false;
+  bool run_huge_page_bench = false;
+  int bench_vars = 200;
+  bool run_kernel_check = false;
+  bool run_row_check = false;
+  bool run_store_check = false;
+  bool run_batch = false;
+  bool run_pairing_check = false;
+  bool run_pairing_bench = false;
+  Index pairing_terms = 0;
+  Index row_trials = 1000;
+  Index store_trials = 200;
+  Index kernel_trials = 100000;
+  ConsistencyOptions options;
   for (int i = 1; i < argc; i++) {
     std::string arg = argv[i];
     if (arg == "--test" || arg == "-t") {
@@ -77,6 +137,169 @@ int main(int argc, char* argv[]) {
         num_workers = std::stoi(argv[i+1]);
         i++;
       }
+    } else if (arg == "--worklist") {
+      options.use_worklist = true;
+    } else if (arg == "--shared-state") {
+      options.shared_state = true;
+    } else if (arg == "--steal") {
+      options.work_stealing = true;
+      if (i + 1 < argc && argv[i+1][0] != '-') {
+        options.task_size = std::stoull(argv[i+1]);
+        i++;
+      }
+    } else if (arg == "--pool") {
+      options.use_pool = true;
+    } else if (arg == "--kernel") {
+      if (i + 1 < argc) {
+        std::string kernel = argv[i+1];
+        if (kernel == "scalar") {
+          set_basis_kernel(BasisKernel::SCALAR);
+        } else if (kernel == "bitsliced") {
+          set_basis_kernel(BasisKernel::BITSLICED);
+        } else {
+          std::cerr << "Unknown kernel: " << kernel << std::endl;
+          return 1;
+        }
+        i++;
+      }
+    } else if (arg == "--combine-cache") {
+      size_t entries = 65536;
+      if (i + 1 < argc && std::isdigit(argv[i+1][0])) {
+        entries = std::stoull(argv[i+1]);
+        i++;
+      }
+      set_combine_cache(entries);
+    } else if (arg == "--kernel-check") {
+      run_kernel_check = true;
+      if (i + 1 < argc && argv[i+1][0] != '-') {
+        kernel_trials = std::stoull(argv[i+1]);
+        i++;
+      }
+    } else if (arg == "--huge-pages") {
+      set_huge_pages(true);
+    } else if (arg == "--huge-page-bench") {
+      run_huge_page_bench = true;
+      bench_vars = 1000;
+      if (i + 1 < argc && argv[i+1][0] != '-') {
+        bench_vars = std::stoi(argv[i+1]);
+        i++;
+      }
+    } else if (arg == "--layout-bench") {
+      run_layout_bench = true;
+      if (i + 1 < argc && argv[i+1][0] != '-') {
+        bench_vars = std::stoi(argv[i+1]);
+        i++;
+      }
+    } else if (arg == "--tile") {
+      options.tile_size = 64;
+      if (i + 1 < argc && argv[i+1][0] != '-') {
+        options.tile_size = std::stoull(argv[i+1]);
+        i++;
+      }
+    } else if (arg == "--tile-terms") {
+      options.tile_terms = 32;
+      if (i + 1 < argc && argv[i+1][0] != '-') {
+        options.tile_terms = std::stoull(argv[i+1]);
+        i++;
+      }
+    } else if (arg == "--batch") {
+      run_batch = true;
+    } else if (arg == "--no-small-engine") {
+      options.small_engine = false;
+    } else if (arg == "--zero-page-states") {
+      options.zero_page_states = true;
+    } else if (arg == "--max-memory") {
+      if (i + 1 < argc) {
+        try {
+          options.max_memory = parse_memory_size(argv[i+1]);
+        } catch (const std::invalid_argument&) {
+          std::cerr << "Unknown memory size: " << argv[i+1] << std::endl;
+          return 1;
+        }
+        i++;
+      }
+    } else if (arg == "--spill-dir") {
+      if (i + 1 < argc) {
+        options.spill_dir = argv[i+1];
+        options.zero_page_states = true;
+        // a spilled store pages in whole slabs at a time
+        if (options.tile_terms == 0) {
+          options.tile_terms = 32;
+        }
+        i++;
+      }
+    } else if (arg == "--state-store") {
+      if (i + 1 < argc) {
+        std::string store = argv[i+1];
+        if (store == "dense") {
+          options.state_backend = StateBackend::DENSE;
+        } else if (store == "nibble") {
+          options.state_backend = StateBackend::NIBBLE;
+        } else if (store == "bit") {
+          options.state_backend = StateBackend::BIT;
+        } else {
+          std::cerr << "Unknown state store: " << store << std::endl;
+          return 1;
+        }
+        i++;
+      }
+    } else if (arg == "--row-propagation") {
+      options.row_propagation = true;
+    } else if (arg == "--row-storage") {
+      if (i + 1 < argc) {
+        std::string storage = argv[i+1];
+        if (storage == "bytes") {
+          set_row_storage(RowStorage::BYTES);
+        } else if (storage == "bitsliced") {
+          set_row_storage(RowStorage::BITSLICED);
+        } else {
+          std::cerr << "Unknown row storage: " << storage << std::endl;
+          return 1;
+        }
+        i++;
+      }
+    } else if (arg == "--cpu") {
+      if (i + 1 < argc) {
+        CpuLevel level;
+        if (!parse_cpu_level(argv[i+1], level)) {
+          std::cerr << "Unknown cpu level: " << argv[i+1] << std::endl;
+          return 1;
+        }
+        if (!set_cpu_level(level)) {
+          std::cerr << "This cpu does not support " << argv[i+1]
+                    << ", the best it has is "
+                    << cpu_level_name(detect_cpu_level()) << std::endl;
+          return 1;
+        }
+        std::cout << "Using " << cpu_level_name(level) << " kernels\n";
+        i++;
+      }
+    } else if (arg == "--row-check") {
+      run_row_check = true;
+      if (i + 1 < argc && std::isdigit(argv[i+1][0])) {
+        row_trials = std::stoull(argv[i+1]);
+        i++;
+      }
+    } else if (arg == "--store-check") {
+      run_store_check = true;
+      if (i + 1 < argc && std::isdigit(argv[i+1][0])) {
+        store_trials = std::stoull(argv[i+1]);
+        i++;
+      }
+    } else if (arg == "--pairing-check" || arg == "--pairing-bench") {
+      run_pairing_check = arg == "--pairing-check";
+      run_pairing_bench = !run_pairing_check;
+      if (i + 1 < argc && std::isdigit(argv[i+1][0])) {
+        pairing_terms = std::stoull(argv[i+1]);
+        i++;
+      }
+    } else if (arg == "--skip-unconstrained") {
+      options.skip_unconstrained = true;
+    } else if (arg == "--timeout") {
+      if (i + 1 < argc) {
+        options.timeout_ms = std::stoull(argv[i+1]);
+        i++;
+      }
     } else if (arg == "--help" || arg == "-h") {
       std::cout << "Usage: " << argv[0] << " [options] [cnf_file]\n";
       std::cout << "Options:\n";
@@ -87,6 +310,34 @@ int main(int argc, char* argv[]) {
       std::cout << "  --solve, -s            Find and output a solution if formula is satisfiable\n";
       std::cout << "  --output, -o [file]    Save solution to the specified file\n";
       std::cout << "  --workers, -w [num]    Number of worker threads for parallel execution (default: 1)\n";
+      std::cout << "  --worklist             Only revisit basis pairs touching changed states\n";
+      std::cout << "  --shared-state         Parallel workers prune one shared store in place\n";
+      std::cout << "  --steal [size]         Schedule parallel work as stealable tasks (default: 4096 basis pairs)\n";
+      std::cout << "  --pool                 Reuse one pool of pinned worker threads for the whole run\n";
+      std::cout << "  --timeout [ms]         Give up with an unknown result after this many milliseconds\n";
+      std::cout << "  --skip-unconstrained   Skip basis pairs whose terms are all still unconstrained\n";
+      std::cout << "  --tile [size]          Sweep basis pairs in cache sized tiles of bases (default: 64)\n";
+      std::cout << "  --tile-terms [num]     Sweep basis pairs in tiles of num largest terms (default: 32)\n";
+      std::cout << "  --layout-bench [vars]  Compare cache misses of the basis layouts (default: 200 variables)\n";
+      std::cout << "  --huge-pages           Put the state arrays on transparent huge pages\n";
+      std::cout << "  --huge-page-bench [n]  Time sweeps on 4 KiB and huge pages at up to n variables (default: 1000)\n";
+      std::cout << "  --kernel [name]        Basis combination kernel: bitsliced (default) or scalar\n";
+      std::cout << "  --combine-cache [num]  Memoize basis combinations in a per thread cache (default: 65536 entries)\n";
+      std::cout << "  --kernel-check [num]   Compare the kernels on random basis pairs (default: 100000)\n";
+      std::cout << "  --batch                Run the --test formulas in SIMD lanes and compare with one at a time\n";
+      std::cout << "  --zero-page-states     Store basis states inverted in lazily committed zero pages\n";
+      std::cout << "  --spill-dir [dir]      Back the zero page basis states with a file in dir, swept in term tiles\n";
+      std::cout << "  --max-memory [size]    Fit the solve into size bytes, e.g. 512M or 8G (default: the cgroup limit)\n";
+      std::cout << "  --state-store [name]   dense (default), nibble (2 pairs/byte) or bit (also 4 terms/byte)\n";
+      std::cout << "  --row-propagation      Propagate through every basis between full sweeps\n";
+      std::cout << "  --no-small-engine      Run formulas of up to 64 terms through the general engine too\n";
+      std::cout << "  --row-storage [name]   States of the row sweep: bytes (default) or bitsliced\n";
+      std::cout << "  --row-check [num]      Compare row sweeps with per basis sweeps (default: 1000)\n";
+      std::cout << "  --store-check [num]    Compare the state stores with the dense one (default: 200)\n";
+      std::cout << "  --pairing-check [num]  Round trip every pair and basis index of num terms (default: 400)\n";
+      std::cout << "  --pairing-bench [num]  Time the pairing functions on num terms (default: 1000)\n";
+      std::cout << "  --cpu [name]           Kernel variant: scalar, sse4.2, avx2 or avx512 (default: best supported, "
+                << cpu_level_name(detect_cpu_level()) << " here)\n";
       std::cout << "  --help, -h             Show this help message\n";
       return 0;
     } else {
@@ -94,20 +345,49 @@ int main(int argc, char* argv[]) {
     }
   }
 
+  std::signal(SIGINT, handle_interrupt);
   try {
-    if (run_tests) {
+    if (run_layout_bench) {
+      benchmark_basis_layouts(bench_vars, 1000000);
+    } else if (run_huge_page_bench) {
+      benchmark_huge_pages(bench_vars);
+    } else if (run_kernel_check) {
+      return check_basis_kernels(12, kernel_trials) ? 0 : 1;
+    } else if (run_pairing_check) {
+      return check_pairing(pairing_terms ? pairing_terms : 400) ? 0 : 1;
+    } else if (run_pairing_bench) {
+      benchmark_pairing(pairing_terms ? pairing_terms : 1000);
+    } else if (run_row_check) {
+      return check_basis_rows(40, row_trials) ? 0 : 1;
+    } else if (run_store_check) {
+      return check_state_stores(10, store_trials) ? 0 : 1;
+    } else if (run_tests && run_batch) {
+      return test_batch_formulas(num_tests, test_vars, test_clauses,
+                                 max_literals) ? 0 : 1;
+    } else if (run_tests) {
       // Run tests on random formulas
       test_random_formulas(num_workers,
 			   num_tests,
                            test_vars,
                            test_clauses,
                            max_literals,
-                           find_solution);
+                           find_solution,
+                           options);
     } else if (!cnf_file.empty()) {
       // Parse the CNF file
       int num_vars, num_clauses;
       std::cout << "Parsing CNF file: " << cnf_file << std::endl;
       auto cnf_clauses = parse_cnf_file(cnf_file, num_vars, num_clauses);
+      // clauses longer than 3 literals get auxiliary terms
+      Index num_terms = num_vars;
+      for (const auto& clause : cnf_clauses) {
+        if (clause.size() > 3) {
+          num_terms += clause.size() - 3;
+        }
+      }
+      if (!index_range_fits(num_terms)) {
+        exec_wider_build(argv);
+      }
             
       std::cout << "Formula details:\n";
       std::cout << "- Variables: " << num_vars << std::endl;
@@ -134,12 +414,14 @@ int main(int argc, char* argv[]) {
 			     cnf_clauses,
 			     num_vars,
 			     find_solution,
-			     solution_file);
+			     solution_file,
+			     options);
             
       // Run brute force check for small instances
       int num_solutions = 0;
       bool brute_force_result = false;
-      if (num_vars <= 20) {
+      bool stopped = engine_stop_reason() != StopReason::NONE;
+      if (num_vars <= 20 && !stopped) {
         std::cout << "\nRunning brute force check...\n";
         brute_force_result = check_satisfiability_brute_force(
 							      cnf_clauses,
@@ -150,7 +432,9 @@ int main(int argc, char* argv[]) {
             
       // Report final result
       std::cout << "\nFinal result:\n";
-      if (num_vars <= 20 && !result && !brute_force_result) {
+      if (stopped) {
+        std::cout << "Formula is UNKNOWN (solve stopped early)\n";
+      } else if (num_vars <= 20 && !result && !brute_force_result) {
         std::cout << "Formula is UNSATISFIABLE (confirmed by brute force)\n";
       } else if (num_vars <= 20 && brute_force_result) {
         std::cout << "Formula is SATISFIABLE with "
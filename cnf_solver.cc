@@ -25,19 +25,22 @@
 #include "pairing.h"
 #include "basis_consistency.h"
 #include "solution_finder.h"
+#include "memory_budget.h"
+#include "huge_pages.h"
 #include <chrono>
 #include <iostream>
 #include <algorithm>
 #include <set>
 #include <fstream>
 #include <sstream>
+#include <stdexcept>
 
 // Directly apply CNF constraints without creating unnecessary dummy variables
-bool apply_constraints(const std::vector<std::vector<Literal>>& cnf_clauses,
-		       int& num_vars,
-		       std::vector<uint8_t>& term_states,
-		       std::vector<uint8_t>& pair_states,
-		       std::vector<uint8_t>& basis_states) {
+template <typename Store>
+static bool apply_constraints_impl
+(const std::vector<std::vector<Literal>>& cnf_clauses,
+ int& num_vars,
+ Store& states) {
 
   Index max_var_id = num_vars;
   for(const auto& clause : cnf_clauses) {
@@ -48,29 +51,26 @@ bool apply_constraints(const std::vector<std::vector<Literal>>& cnf_clauses,
     std::sort(sorted_clause.begin(),sorted_clause.end(),comp);
     if(sorted_clause.size() == 0) continue;
     if(sorted_clause.size() == 1) {
-      term_states[sorted_clause[0].var -1] &=
-	oned_clear_masks[sorted_clause[0].negated];
-      if(!(term_states[sorted_clause[0].var -1])) {
+      if(!states.narrow_term(sorted_clause[0].var -1,
+			     oned_clear_masks[sorted_clause[0].negated])) {
 	return false;
       }
     } else if(sorted_clause.size() == 2) {
-      Index idx = pair2d(sorted_clause[0].var -1,
-			    sorted_clause[1].var -1);
-      pair_states[idx] &=
-	twod_clear_masks[sorted_clause[0].negated][sorted_clause[1].negated];
-      if(!(pair_states[idx])) {
+      if(!states.narrow_pair(sorted_clause[0].var -1,
+			     sorted_clause[1].var -1,
+			     twod_clear_masks
+			     [sorted_clause[0].negated]
+			     [sorted_clause[1].negated])) {
 	return false;
       }
     } else if(sorted_clause.size() == 3) {
-      Index idx = pair3d(sorted_clause[0].var -1,
-			    sorted_clause[1].var -1,
-			    sorted_clause[2].var -1);
-      basis_states[idx] &=
-	threed_clear_masks
-	[sorted_clause[0].negated]
-	[sorted_clause[1].negated]
-	[sorted_clause[2].negated];
-      if(!(basis_states[idx])) {
+      if(!states.narrow_basis(sorted_clause[0].var -1,
+			      sorted_clause[1].var -1,
+			      sorted_clause[2].var -1,
+			      threed_clear_masks
+			      [sorted_clause[0].negated]
+			      [sorted_clause[1].negated]
+			      [sorted_clause[2].negated])) {
 	return false;
       }
     } else {
@@ -83,86 +83,244 @@ bool apply_constraints(const std::vector<std::vector<Literal>>& cnf_clauses,
       // (¬z2 ∨ d ∨ z3), ..., (¬z_n ∨ last ∨ second_last) 
 
       // resize arrays
-      term_states.resize((term_states.size() + sorted_clause.size() - 3),
-			 SET_ANY);
-      pair_states.
-	resize(calculate_array_size_2d(term_states.size()),SET_ANY_ANY);
-      basis_states.
-	resize(calculate_array_size_3d(term_states.size()),SET_ANY_ANY_ANY);
+      states.add_terms(sorted_clause.size() - 3);
       // Handle first clause (a ∨ b ∨ z1)
-      Index idx = pair3d(sorted_clause[0].var -1,
-			    sorted_clause[1].var -1,
-			    max_var_id);
-      
-      basis_states[idx] &=
-	threed_clear_masks
-	[(int)sorted_clause[0].negated]
-	[(int)sorted_clause[1].negated]
-	[0];
+      states.narrow_basis(sorted_clause[0].var -1,
+			  sorted_clause[1].var -1,
+			  max_var_id,
+			  threed_clear_masks
+			  [(int)sorted_clause[0].negated]
+			  [(int)sorted_clause[1].negated]
+			  [0]);
       
       ++max_var_id; // Increment after use
       
       // Handle intermediate clauses (¬z_i ∨ term ∨ z_{i+1})
       for (size_t i = 2; i < sorted_clause.size() - 2; ++i) {
         Index prev_var_id = max_var_id - 1;
-        idx = pair3d(sorted_clause[i].var -1,
-		     prev_var_id,
-		     max_var_id);
-        basis_states[idx] &=
-          threed_clear_masks
-          [(int)sorted_clause[i].negated]
-          [1]
-          [0];
+        states.narrow_basis(sorted_clause[i].var -1,
+			    prev_var_id,
+			    max_var_id,
+			    threed_clear_masks
+			    [(int)sorted_clause[i].negated]
+			    [1]
+			    [0]);
         ++max_var_id;
       }
       
       // Handle last clause ( -z_i v (last_term -1) v (last_term)
       Index prev_var_id = max_var_id - 1;
-      idx = pair3d(sorted_clause[sorted_clause.size() -2].var -1,
-		   sorted_clause[sorted_clause.size() -1].var -1,
-		   prev_var_id);
-      basis_states[idx] &=
-	threed_clear_masks
-	[sorted_clause[sorted_clause.size() -2].negated]
-	[sorted_clause[sorted_clause.size() -1].negated]
-	[1];
+      states.narrow_basis(sorted_clause[sorted_clause.size() -2].var -1,
+			  sorted_clause[sorted_clause.size() -1].var -1,
+			  prev_var_id,
+			  threed_clear_masks
+			  [sorted_clause[sorted_clause.size() -2].negated]
+			  [sorted_clause[sorted_clause.size() -1].negated]
+			  [1]);
     }
   }
   num_vars = max_var_id;
   return true; // No contradictions found during initial constraint application
 }
 
-// Check satisfiability
-bool check_satisfiability
-(int num_workers,
+bool apply_constraints(const std::vector<std::vector<Literal>>& cnf_clauses,
+		       int& num_vars,
+		       std::vector<uint8_t>& term_states,
+		       std::vector<uint8_t>& pair_states,
+		       std::vector<uint8_t>& basis_states) {
+  // the store takes the arrays over for the call
+  DenseStateStore states;
+  states.terms = std::move(term_states);
+  states.pairs = std::move(pair_states);
+  states.bases = std::move(basis_states);
+  bool consistent = apply_constraints_impl(cnf_clauses, num_vars, states);
+  term_states = std::move(states.terms);
+  pair_states = std::move(states.pairs);
+  basis_states = std::move(states.bases);
+  return consistent;
+}
+
+// Tell the user when a deadline or an interrupt cut the solve short.
+// the states are still sound but prove nothing either way.
+static bool report_engine_stop() {
+  StopReason reason = engine_stop_reason();
+  if (reason == StopReason::NONE) {
+    return false;
+  }
+  std::cout << "Solve stopped early ("
+	    << (reason == StopReason::DEADLINE ? "deadline reached" :
+		"interrupted")
+	    << "), result unknown" << std::endl;
+  return true;
+}
+
+// Refuse formulas whose indices this build's Index cannot hold
+// rather than let them wrap around
+static void require_index_range(Index num_terms) {
+  if (!index_range_fits(num_terms)) {
+    std::ostringstream message;
+    message << num_terms << " terms overflow the " << INDEX_BITS
+	    << " bit Index of this build, rebuild with a wider "
+	    << "INDEX_BITS (make index-variants)";
+    throw std::overflow_error(message.str());
+  }
+}
+
+// Whether check_satisfiability solves in a SmallStateStore with the
+// small engine: a formula of at most SMALL_ENGINE_MAX_TERMS terms in
+// dense states when nothing else is asked for
+static bool use_small_engine(Index num_terms,
+			     int num_workers,
+			     const ConsistencyOptions& options) {
+  return options.small_engine &&
+    num_terms <= SMALL_ENGINE_MAX_TERMS &&
+    num_workers < 2 && !options.use_worklist &&
+    !options.skip_unconstrained && options.tile_size == 0 &&
+    options.tile_terms == 0 && !options.row_propagation &&
+    !options.zero_page_states &&
+    options.state_backend == StateBackend::DENSE;
+}
+
+// The terms of a formula once clauses longer than 3 literals are split
+static Index formula_terms(const std::vector<std::vector<Literal>>& cnf_clauses,
+			   int num_vars) {
+  Index num_terms = num_vars;
+  for (const auto& clause : cnf_clauses) {
+    if (clause.size() > 3) {
+      num_terms += clause.size() - 3;
+    }
+  }
+  return num_terms;
+}
+
+// Run the global consistency engine options ask for over every
+// basis pair
+template <typename Store>
+static void run_engine(Store& states,
+		       bool& has_contradiction,
+		       Index ending_basis_pair,
+		       int num_workers,
+		       const ConsistencyOptions& options) {
+  if(num_workers < 2) {
+    ensure_global_consistency(states,
+			      has_contradiction,
+			      0,ending_basis_pair,
+			      options);
+  } else {
+    parallel_ensure_global_consistency(states,
+				       has_contradiction,
+				       0,ending_basis_pair,
+				       num_workers,
+				       options);
+  }
+}
+
+// check_satisfiability only picks the small store for the small
+// engine
+static void run_engine(SmallStateStore& states,
+		       bool& has_contradiction,
+		       Index /* ending_basis_pair */,
+		       int /* num_workers */,
+		       const ConsistencyOptions& /* options */) {
+  small_ensure_global_consistency(states, has_contradiction);
+}
+
+static void report_state_store(const DenseStateStore& /* states */) {
+}
+
+static void report_state_store(const SmallStateStore& /* states */) {
+}
+
+static void report_state_store(const ZeroPageStateStore& states) {
+  std::cout << "- Resident basis states: "
+	    << (states.bases.resident_bytes() >> 10) << " of "
+	    << (states.bases.mapped_bytes() >> 10) << " KiB";
+  if (!states.bases.spill_dir().empty()) {
+    std::cout << ", spilled to " << states.bases.spill_dir();
+  }
+  std::cout << std::endl;
+}
+
+template <typename Store>
+static void report_state_store(const Store& states) {
+  std::cout << "- State store: " << (states.memory_bytes() >> 10)
+	    << " KiB" << std::endl;
+}
+
+static void report_huge_pages(const std::vector<uint8_t>& basis_states) {
+  std::cout << "- Huge pages: "
+	    << (huge_page_bytes(basis_states.data(),
+				basis_states.size()) >> 10)
+	    << " of " << (basis_states.size() >> 10)
+	    << " KiB of basis states (transparent huge pages: "
+	    << transparent_huge_page_mode() << ")" << std::endl;
+}
+
+// zero page bases commit a page at a time on purpose
+static void report_huge_pages(const ZeroPageStates& /* basis_states */) {
+}
+
+// the small store lives on the stack
+static void report_huge_pages(const FixedStates& /* basis_states */) {
+}
+
+template <typename Store>
+static SATSolution find_solution_in(Store& states,
+				    int num_vars,
+				    int num_workers,
+				    const ConsistencyOptions& options) {
+  return determine_solution(states, num_vars, num_workers, options);
+}
+
+// the solution finder runs on a dense copy of the small store
+static SATSolution find_solution_in(SmallStateStore& states,
+				    int num_vars,
+				    int num_workers,
+				    const ConsistencyOptions& options) {
+  DenseStateStore dense;
+  dense.terms.assign(states.terms.data(),
+		     states.terms.data() + states.terms.size());
+  dense.pairs.assign(states.pairs.data(),
+		     states.pairs.data() + states.pairs.size());
+  dense.bases.assign(states.bases.data(),
+		     states.bases.data() + states.bases.size());
+  return determine_solution(dense, num_vars, num_workers, options);
+}
+
+// check_satisfiability in states, an empty store of the kind options
+// asked for
+template <typename Store>
+static bool check_satisfiability_with
+(Store& states,
+ int num_workers,
  const std::vector<std::vector<Literal>>& cnf_clauses, 
  int num_vars, 
  bool find_solution,
- const std::string& solution_file) {
-  // Initialize state arrays
-  std::vector<uint8_t> term_states(num_vars, SET_ANY);
-  std::vector<uint8_t> pair_states(calculate_array_size_2d(num_vars), 
-				   SET_ANY_ANY);
-  std::vector<uint8_t> basis_states(calculate_array_size_3d(num_vars), 
-				    SET_ANY_ANY_ANY);
+ const std::string& solution_file,
+ const ConsistencyOptions& options) {
+  // room for the terms long clauses add, so no level is ever held
+  // twice while it grows
+  states.reserve_terms(formula_terms(cnf_clauses, num_vars));
+  states.add_terms(num_vars);
+
   // Apply constraints directly
   int working_num_vars = num_vars;
 
   bool initial_consistency =
-    apply_constraints(cnf_clauses, 
+    apply_constraints_impl(cnf_clauses, 
 		      working_num_vars, 
-		      term_states, 
-		      pair_states, 
-		      basis_states);
+		      states);
     
   if (!initial_consistency) {
     std::cout << "Formula is unsatisfiable (detected during initial constraint application)" << std::endl;
     return false;
   }
+  // clauses longer than 3 literals add terms
+  require_index_range(working_num_vars);
 
   // Cross-level consistency check
   bool cross_level_consistent =
-    ensure_cross_level_consistency(term_states, pair_states, basis_states);
+    ensure_cross_level_consistency(states);
   if (!cross_level_consistent) {
     std::cout << "Formula is unsatisfiable (detected during cross-level consistency check)" << std::endl;
     return false;
@@ -172,20 +330,8 @@ bool check_satisfiability
   Index ending_basis_pair =
     calculate_array_size_2d(calculate_array_size_3d(working_num_vars));
   auto start = std::chrono::high_resolution_clock::now();
-  if(num_workers < 2) {
-    ensure_global_consistency(term_states, 
-			      pair_states, 
-			      basis_states, 
-			      has_contradiction,
-			      0,ending_basis_pair);
-  } else {
-    parallel_ensure_global_consistency(term_states, 
-				       pair_states, 
-				       basis_states, 
-				       has_contradiction,
-				       0,ending_basis_pair,
-				       num_workers);
-  }
+  run_engine(states, has_contradiction, ending_basis_pair, num_workers,
+	     options);
   auto end = std::chrono::high_resolution_clock::now();
   auto duration = 
     std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
@@ -194,19 +340,35 @@ bool check_satisfiability
   std::cout << "- Contradiction detected: "
 	    << (has_contradiction ? "Yes" : "No") << std::endl;
   std::cout << "- Time taken: " << duration.count() << " ms" << std::endl;
+  report_state_store(states);
+  if (huge_pages_enabled()) {
+    report_huge_pages(states.bases);
+  }
+  CombineCacheStats cache_stats = combine_cache_stats();
+  if (cache_stats.lookups) {
+    std::cout << "- Combine cache hits: " << cache_stats.hits << " of "
+	      << cache_stats.lookups << " ("
+	      << (100.0 * cache_stats.hits / cache_stats.lookups) << "%)"
+	      << std::endl;
+  }
 
   // If a contradiction was detected, the formula is unsatisfiable
   if (has_contradiction) {
     return false;
   }
+  if (report_engine_stop()) {
+    return false;
+  }
   // If we want to find a solution and no contradiction was detected
   if (find_solution) {
     SATSolution solution = 
-      determine_solution(basis_states, 
-			 pair_states,
-			 term_states,
-			 num_vars,
-			 num_workers);
+      find_solution_in(states,
+		       num_vars,
+		       num_workers,
+		       options);
+    if (report_engine_stop()) {
+      return false;
+    }
 
     // Validate the solution against the original problem
     bool valid = validate_solution(solution, cnf_clauses);
@@ -235,17 +397,181 @@ bool check_satisfiability
   return true;
 }
 
-// Add this function (outside the #ifdef)
-bool ensure_cross_level_consistency(std::vector<uint8_t>& term_states,
-				    std::vector<uint8_t>& pair_states,
-				    std::vector<uint8_t>& basis_states) {
+// Check satisfiability
+bool check_satisfiability
+(int num_workers,
+ const std::vector<std::vector<Literal>>& cnf_clauses, 
+ int num_vars, 
+ bool find_solution,
+ const std::string& solution_file,
+ const ConsistencyOptions& requested_options) {
+  arm_engine_deadline(requested_options.timeout_ms);
+  reset_combine_cache_stats();
+  require_index_range(num_vars);
+  // settle on workers and a store that fit before allocating any
+  ConsistencyOptions options = requested_options;
+  plan_memory(cnf_clauses, num_vars, num_workers, options);
+  if (options.zero_page_states ||
+      options.state_backend != StateBackend::DENSE) {
+    // the other engines need a store of plain bytes
+    if (options.use_worklist || options.skip_unconstrained ||
+	options.row_propagation ||
+	(num_workers > 1 &&
+	 (options.shared_state || options.work_stealing))) {
+      throw std::invalid_argument("packed and zero page state stores "
+				  "need the plain or tiled sweep and the "
+				  "copy-and-merge parallel engine");
+    }
+  }
+  if (options.zero_page_states) {
+    if (options.state_backend != StateBackend::DENSE) {
+      throw std::invalid_argument("zero page basis states keep dense "
+				  "terms and pairs");
+    }
+    ZeroPageStateStore states;
+    if (!options.spill_dir.empty()) {
+      states.bases = ZeroPageStates(0, options.spill_dir);
+    }
+    return check_satisfiability_with(states, num_workers,
+				     cnf_clauses, num_vars, find_solution,
+				     solution_file, options);
+  }
+  if (options.state_backend == StateBackend::NIBBLE) {
+    NibbleStateStore states;
+    return check_satisfiability_with(states, num_workers,
+				     cnf_clauses, num_vars, find_solution,
+				     solution_file, options);
+  }
+  if (options.state_backend == StateBackend::BIT) {
+    BitStateStore states;
+    return check_satisfiability_with(states, num_workers,
+				     cnf_clauses, num_vars, find_solution,
+				     solution_file, options);
+  }
+  if (use_small_engine(formula_terms(cnf_clauses, num_vars), num_workers,
+		       options)) {
+    SmallStateBuffer<SMALL_ENGINE_MAX_TERMS> buffer;
+    SmallStateStore states = buffer.store();
+    return check_satisfiability_with(states, num_workers,
+				     cnf_clauses, num_vars, find_solution,
+				     solution_file, options);
+  }
+  DenseStateStore states;
+  return check_satisfiability_with(states, num_workers,
+				   cnf_clauses, num_vars, find_solution,
+				   solution_file, options);
+}
+
+std::vector<bool> check_satisfiability_batch
+(const std::vector<std::vector<std::vector<Literal>>>& formulas,
+ int num_vars) {
+  arm_engine_deadline(0);
+  require_index_range(num_vars);
+  const Index lanes = batch_lanes();
+  std::vector<bool> results(formulas.size(), false);
+  // every lane of a batch is as wide as its widest formula, so the
+  // formulas are batched in the order of the terms their long clauses
+  // add
+  std::vector<Index> extra_terms(formulas.size(), 0);
+  for (Index formula = 0; formula < formulas.size(); formula++) {
+    for (const auto& clause : formulas[formula]) {
+      if (clause.size() > 3) {
+	extra_terms[formula] += clause.size() - 3;
+      }
+    }
+  }
+  std::vector<Index> order(formulas.size());
+  for (Index formula = 0; formula < formulas.size(); formula++) {
+    order[formula] = formula;
+  }
+  std::stable_sort(order.begin(), order.end(),
+		   [&](Index a, Index b) {
+		     return extra_terms[a] < extra_terms[b];
+		   });
+  for (Index first = 0; first < formulas.size(); first += lanes) {
+    const Index used = std::min<Index>(lanes, formulas.size() - first);
+    // clauses longer than 3 literals add terms, so every formula is
+    // constrained before the lanes are sized for the widest one
+    std::vector<DenseStateStore> lane_states(used);
+    Index num_terms = num_vars;
+    uint64_t refuted = 0;
+    for (Index lane = 0; lane < used; lane++) {
+      DenseStateStore& states = lane_states[lane];
+      states.add_terms(num_vars);
+      int working_num_vars = num_vars;
+      if (!apply_constraints_impl(formulas[order[first + lane]],
+				  working_num_vars,
+				  states) ||
+	  !ensure_cross_level_consistency(states)) {
+	refuted |= uint64_t(1) << lane;
+	states = DenseStateStore();
+	continue;
+      }
+      num_terms = std::max<Index>(num_terms, working_num_vars);
+    }
+    uint64_t used_lanes = (used == 64) ? ~uint64_t(0) :
+      (uint64_t(1) << used) - 1;
+    if ((refuted & used_lanes) == used_lanes) {
+      continue;			// nothing left to sweep
+    }
+    require_index_range(num_terms);
+
+    // unused lanes, formulas already refuted and the terms a narrower
+    // formula lacks stay unconstrained.  the states of the first n
+    // terms are a prefix of every level, so a lane copies its levels
+    // over as they are.
+    const Index num_bases = calculate_array_size_3d(num_terms);
+    std::vector<uint8_t> term_states(num_terms * lanes, SET_ANY);
+    std::vector<uint8_t> pair_states(calculate_array_size_2d(num_terms) *
+				     lanes, SET_ANY_ANY);
+    std::vector<uint8_t> basis_states(num_bases * lanes, SET_ANY_ANY_ANY);
+    for (Index lane = 0; lane < used; lane++) {
+      if (refuted & (uint64_t(1) << lane)) {
+	continue;
+      }
+      const DenseStateStore& states = lane_states[lane];
+      for (Index x = 0; x < states.terms.size(); x++) {
+	term_states[x * lanes + lane] = states.terms[x];
+      }
+      for (Index x = 0; x < states.pairs.size(); x++) {
+	pair_states[x * lanes + lane] = states.pairs[x];
+      }
+      for (Index x = 0; x < states.bases.size(); x++) {
+	basis_states[x * lanes + lane] = states.bases[x];
+      }
+    }
+    lane_states.clear();
+    // the refuted and unused lanes start out dead, so the sweep ends
+    // as soon as the last live formula is refuted
+    refuted = batch_ensure_global_consistency(term_states,
+					      pair_states,
+					      basis_states,
+					      0,
+					      calculate_array_size_2d(num_bases),
+					      refuted | ~used_lanes);
+    if (engine_stop_reason() != StopReason::NONE) {
+      // the lanes still alive prove nothing either way
+      throw std::runtime_error(engine_stop_reason() == StopReason::DEADLINE ?
+			       "batch solve stopped early (deadline reached)" :
+			       "batch solve stopped early (interrupted)");
+    }
+    for (Index lane = 0; lane < used; lane++) {
+      results[order[first + lane]] = !(refuted & (uint64_t(1) << lane));
+    }
+  }
+  return results;
+}
+
+// Propagate between terms and pairs until neither changes.  the
+// bases are left to the global consistency pass.
+template <typename TermStates, typename PairStates>
+static bool cross_level_consistency(TermStates& term_states,
+				    PairStates& pair_states) {
   bool changed = true;
-  bool globally_changed = false;
     
   while (changed) {
     changed = false;
         
-    // Propagate between terms and pairs
     for (Index i = 0; i < term_states.size(); ++i) {
       for (Index j = i + 1; j < term_states.size(); ++j) {
 	UpdateResult result =
@@ -256,37 +582,24 @@ bool ensure_cross_level_consistency(std::vector<uint8_t>& term_states,
                 
 	if (result.changed) {
 	  changed = true;
-	  globally_changed = true;
-	}
-      }
-    }
-#if 0        
-    // Also check basis states if we have any
-    if (!basis_states.empty()) {
-      for (Index i = 0; i < term_states.size() - 2; i++) {
-	for (Index j = i + 1; j < term_states.size() - 1; j++) {
-	  for (Index k = j + 1; k < term_states.size(); k++) {
-	    Index basis_idx = pair3d(i, j, k);
-	    UpdateResult result = update_basis_states(i, j, k, basis_idx,
-						      term_states, pair_states, basis_states);
-                        
-	    if (result.has_zero) {
-	      return false; // Contradiction detected
-	    }
-                        
-	    if (result.changed) {
-	      changed = true;
-	      globally_changed = true;
-	    }
-	  }
 	}
       }
     }
-#endif
   }
   return true; // No contradiction detected
 }
 
+bool ensure_cross_level_consistency(std::vector<uint8_t>& term_states,
+				    std::vector<uint8_t>& pair_states,
+				    std::vector<uint8_t>& /* basis_states */) {
+  return cross_level_consistency(term_states, pair_states);
+}
 
+template <typename Store>
+bool ensure_cross_level_consistency(Store& states) {
+  return cross_level_consistency(states.terms, states.pairs);
+}
 
-
+#define INSTANTIATE_CROSS_LEVEL_CONSISTENCY(Store)		\
+  template bool ensure_cross_level_consistency(Store&);
+FOR_EACH_STATE_STORE(INSTANTIATE_CROSS_LEVEL_CONSISTENCY)
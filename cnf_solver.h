@@ -26,6 +26,7 @@
 #include <string>
 #include <cstdint>
 #include "file_parser.h"
+#include "basis_consistency.h"
 
 // Directly apply CNF constraints without creating unnecessary dummy variables
 bool apply_constraints(const std::vector<std::vector<Literal>>& cnf_clauses,
@@ -40,10 +41,23 @@ bool check_satisfiability
  const std::vector<std::vector<Literal>>& cnf_clauses, 
  int num_vars, 
  bool find_solution = false,
- const std::string& solution_file = "");
+ const std::string& solution_file = "",
+ const ConsistencyOptions& options = ConsistencyOptions());
+
+// Check many formulas over the same num_vars variables with the
+// instance-parallel engine, batch_lanes() formulas per sweep.  returns
+// whether each formula is satisfiable, without finding solutions.
+// throws std::runtime_error if a deadline or an interrupt stops the
+// engine before every formula is decided.
+std::vector<bool> check_satisfiability_batch
+(const std::vector<std::vector<std::vector<Literal>>>& formulas,
+ int num_vars);
 
 // Cross-level consistency checking
 bool ensure_cross_level_consistency(std::vector<uint8_t>& term_states,
                                    std::vector<uint8_t>& pair_states,
                                    std::vector<uint8_t>& basis_states);
+// Same on a StateStore, for every store FOR_EACH_STATE_STORE names
+template <typename Store>
+bool ensure_cross_level_consistency(Store& states);
 
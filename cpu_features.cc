@@ -0,0 +1,72 @@
+// MIT License
+
+// Copyright (c) 2025 Daniel Issen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "cpu_features.h"
+
+CpuLevel detect_cpu_level() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") &&
+      __builtin_cpu_supports("avx512bw")) {
+    return CpuLevel::AVX512;
+  }
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2")) {
+    return CpuLevel::AVX2;
+  }
+  if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt")) {
+    return CpuLevel::SSE42;
+  }
+#endif
+  return CpuLevel::SCALAR;
+}
+
+static CpuLevel active_cpu_level = detect_cpu_level();
+
+bool set_cpu_level(CpuLevel level) {
+  if (static_cast<int>(level) > static_cast<int>(detect_cpu_level())) {
+    return false;
+  }
+  active_cpu_level = level;
+  return true;
+}
+
+CpuLevel cpu_level() {
+  return active_cpu_level;
+}
+
+static const char* const cpu_level_names[] = {
+  "scalar", "sse4.2", "avx2", "avx512"
+};
+
+const char* cpu_level_name(CpuLevel level) {
+  return cpu_level_names[static_cast<int>(level)];
+}
+
+bool parse_cpu_level(const std::string& name, CpuLevel& level) {
+  for (int l = 0; l < 4; l++) {
+    if (name == cpu_level_names[l]) {
+      level = static_cast<CpuLevel>(l);
+      return true;
+    }
+  }
+  return false;
+}
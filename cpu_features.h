@@ -0,0 +1,50 @@
+// MIT License
+
+// Copyright (c) 2025 Daniel Issen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Which instruction set the hot kernels run with.  the binary is built
+// for the baseline x86-64 target and carries one copy of each kernel
+// per level (see lane_kernels.h); the best level the cpu supports is
+// picked at startup with cpuid.
+
+#pragma once
+#include <string>
+
+enum class CpuLevel {
+    SCALAR,
+    SSE42,
+    AVX2,
+    AVX512
+};
+
+// The best level this cpu supports
+CpuLevel detect_cpu_level();
+
+// Force a level, for benchmarking the variants against each other.
+// returns false, and keeps the current level, if the cpu does not
+// support it.
+bool set_cpu_level(CpuLevel level);
+CpuLevel cpu_level();
+
+const char* cpu_level_name(CpuLevel level);
+// Level by name (scalar, sse4.2, avx2 or avx512).  returns false for
+// an unknown name.
+bool parse_cpu_level(const std::string& name, CpuLevel& level);
@@ -0,0 +1,103 @@
+// MIT License
+
+// Copyright (c) 2025 Daniel Issen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "huge_pages.h"
+#include <sys/mman.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+static bool huge_pages_on = false;
+
+static const uintptr_t HUGE_PAGE_BYTES = 2u << 20;
+
+void set_huge_pages(bool enabled) {
+  huge_pages_on = enabled;
+}
+
+bool huge_pages_enabled() {
+  return huge_pages_on;
+}
+
+// the mode is the bracketed word, e.g. "always [madvise] never"
+std::string transparent_huge_page_mode() {
+  std::ifstream in("/sys/kernel/mm/transparent_hugepage/enabled");
+  std::string word;
+  while (in >> word) {
+    if (word.size() > 2 && word.front() == '[' && word.back() == ']') {
+      return word.substr(1, word.size() - 2);
+    }
+  }
+  return "unavailable";
+}
+
+bool advise_huge_pages(void* data, size_t bytes) {
+#ifdef MADV_HUGEPAGE
+  uintptr_t start = reinterpret_cast<uintptr_t>(data);
+  uintptr_t first = (start + HUGE_PAGE_BYTES - 1) & ~(HUGE_PAGE_BYTES - 1);
+  uintptr_t last = (start + bytes) & ~(HUGE_PAGE_BYTES - 1);
+  if (last <= first) {
+    return false;
+  }
+  return madvise(reinterpret_cast<void*>(first), last - first,
+		 MADV_HUGEPAGE) == 0;
+#else
+  (void) data;
+  (void) bytes;
+  return false;
+#endif
+}
+
+// sum AnonHugePages over the mappings that overlap the range
+size_t huge_page_bytes(const void* data, size_t bytes) {
+  unsigned long start = reinterpret_cast<unsigned long>(data);
+  unsigned long end = start + bytes;
+  std::ifstream smaps("/proc/self/smaps");
+  std::string line;
+  bool ours = false;
+  size_t total = 0;
+  while (std::getline(smaps, line)) {
+    unsigned long map_start, map_end;
+    if (std::sscanf(line.c_str(), "%lx-%lx", &map_start, &map_end) == 2) {
+      ours = map_start < end && start < map_end;
+    } else if (ours && line.compare(0, 14, "AnonHugePages:") == 0) {
+      total += std::stoull(line.substr(14)) * 1024;
+    }
+  }
+  return std::min(total, bytes);
+}
+
+void reserve_huge(std::vector<uint8_t>& bytes, size_t size) {
+  if (size <= bytes.capacity()) {
+    return;
+  }
+  if (!huge_pages_on) {
+    bytes.reserve(size);
+    return;
+  }
+  // the old states are copied in only after the advice
+  std::vector<uint8_t> fresh;
+  fresh.reserve(size);
+  advise_huge_pages(fresh.data(), size);
+  fresh.assign(bytes.begin(), bytes.end());
+  bytes.swap(fresh);
+}
@@ -0,0 +1,58 @@
+// MIT License
+
+// Copyright (c) 2025 Daniel Issen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Transparent huge pages for the state arrays.  a sweep reads
+// basis_states at scattered offsets through the intermediaries, so
+// once it runs to gigabytes nearly every read misses the TLB with
+// 4 KiB pages.  when the kernel runs transparent huge pages in
+// madvise mode, a std::vector only gets them if its block is advised
+// before anything touches it.  with huge pages on, reserve_huge
+// therefore takes a fresh block, advises the 2 MiB pages inside it
+// and only then copies the old states over.
+//
+// MAP_HUGETLB is not used.  it needs hugetlbfs pages the
+// administrator reserved up front and cannot back a std::vector.
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Whether reserve_huge asks for huge pages, off by default
+void set_huge_pages(bool enabled);
+bool huge_pages_enabled();
+
+// The kernel's transparent huge page mode: always, madvise, never,
+// or unavailable
+std::string transparent_huge_page_mode();
+
+// Advise the 2 MiB pages that lie entirely inside [data, data +
+// bytes).  false if there are none or the kernel refuses.
+bool advise_huge_pages(void* data, size_t bytes);
+
+// Bytes of the mappings under [data, data + bytes) backed by huge
+// pages, at most bytes
+size_t huge_page_bytes(const void* data, size_t bytes);
+
+// Make room for size bytes in bytes, on huge pages when they are on
+void reserve_huge(std::vector<uint8_t>& bytes, size_t size);
@@ -0,0 +1,45 @@
+// MIT License
+
+// Copyright (c) 2025 Daniel Issen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "lane_kernels.h"
+
+extern const LaneKernels scalar_lane_kernels;
+extern const LaneKernels sse42_lane_kernels;
+extern const LaneKernels avx2_lane_kernels;
+extern const LaneKernels avx512_lane_kernels;
+
+const LaneKernels& lane_kernels(CpuLevel level) {
+  switch (level) {
+  case CpuLevel::AVX512:
+    return avx512_lane_kernels;
+  case CpuLevel::AVX2:
+    return avx2_lane_kernels;
+  case CpuLevel::SSE42:
+    return sse42_lane_kernels;
+  default:
+    return scalar_lane_kernels;
+  }
+}
+
+const LaneKernels& lane_kernels() {
+  return lane_kernels(cpu_level());
+}
@@ -0,0 +1,82 @@
+// MIT License
+
+// Copyright (c) 2025 Daniel Issen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// The SIMD kernels, once per CpuLevel.  lane_kernels.inc is compiled
+// four times, by lane_kernels_scalar.cc, lane_kernels_sse42.cc,
+// lane_kernels_avx2.cc and lane_kernels_avx512.cc, each with its own
+// target flags (see the Makefile), and lane_kernels() hands out the
+// copy for the active cpu_level().
+
+#pragma once
+#include <cstdint>
+#include "cpu_features.h"
+#include "pairing.h"
+
+struct LaneKernels {
+    CpuLevel level;
+    // formulas per batch of the instance-parallel engine
+    Index batch_width;
+
+    // One pass of the row sweep over colex ordered states, from basis
+    // (i0,j0,k0) to the end of the n terms.  returns false on a
+    // contradiction.
+    bool (*sweep_rows)(uint8_t* term_states,
+                       uint8_t* pair_states,
+                       uint8_t* basis_states,
+                       Index n,
+                       Index i0, Index j0, Index k0,
+                       bool& changed);
+
+    // update_basis_states on basis (i,j,k) of every instance of a
+    // batch_width batch.  returns the lanes that changed and adds the
+    // lanes that hit a zero state to dead.
+    uint64_t (*update_batch_basis)(Index i, Index j, Index k,
+                                   Index ij_idx, Index ik_idx, Index jk_idx,
+                                   Index basis_idx,
+                                   uint8_t* terms,
+                                   uint8_t* pairs,
+                                   uint8_t* bases,
+                                   uint64_t& dead);
+
+    // states[x] &= other[x] for every x < count.  sets changed if any
+    // state narrowed, returns false if any state became zero.
+    bool (*narrow_states)(uint8_t* states,
+                          const uint8_t* other,
+                          Index count,
+                          bool& changed);
+
+    // Evaluates a cnf on the num_blocks * 64 assignments starting at
+    // first_block * 64, bit b of masks[x] set when assignment
+    // (first_block + x) * 64 + b satisfies every clause.  literal l is
+    // var * 2 + negated with 0 based vars, clause c is
+    // literals[clause_ends[c - 1] .. clause_ends[c]).
+    void (*evaluate_assignments)(const uint32_t* literals,
+                                 const Index* clause_ends,
+                                 Index num_clauses,
+                                 uint64_t first_block,
+                                 Index num_blocks,
+                                 uint64_t* masks);
+};
+
+// The kernels for the active cpu_level()
+const LaneKernels& lane_kernels();
+const LaneKernels& lane_kernels(CpuLevel level);
@@ -0,0 +1,276 @@
+// MIT License
+
+// Copyright (c) 2025 Daniel Issen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "memory_budget.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+size_t cgroup_memory_limit() {
+  // our cgroup first, then the root of the hierarchy, which is ours
+  // inside most containers
+  std::vector<std::string> files;
+  std::ifstream cgroup("/proc/self/cgroup");
+  std::string line;
+  while (std::getline(cgroup, line)) {
+    if (line.compare(0, 3, "0::") == 0) {
+      files.push_back("/sys/fs/cgroup" + line.substr(3) + "/memory.max");
+    } else if (line.find(":memory:") != std::string::npos) {
+      files.push_back("/sys/fs/cgroup/memory" +
+		      line.substr(line.find(":memory:") + 8) +
+		      "/memory.limit_in_bytes");
+    }
+  }
+  files.push_back("/sys/fs/cgroup/memory.max");
+  files.push_back("/sys/fs/cgroup/memory/memory.limit_in_bytes");
+  for (const std::string& file : files) {
+    std::ifstream in(file);
+    std::string value;
+    if (!(in >> value)) {
+      continue;
+    }
+    // v2 says max, v1 a number near 2^63
+    if (value == "max") {
+      return 0;
+    }
+    unsigned long long limit = std::stoull(value);
+    return (limit >= (1ull << 60)) ? 0 : static_cast<size_t>(limit);
+  }
+  return 0;
+}
+
+size_t parse_memory_size(const std::string& text) {
+  size_t end = 0;
+  while (end < text.size() && std::isdigit(text[end])) {
+    ++end;
+  }
+  if (end == 0 || end + 1 < text.size()) {
+    throw std::invalid_argument("bad memory size: " + text);
+  }
+  unsigned shift = 0;
+  if (end < text.size()) {
+    switch (std::toupper(text[end])) {
+    case 'K': shift = 10; break;
+    case 'M': shift = 20; break;
+    case 'G': shift = 30; break;
+    case 'T': shift = 40; break;
+    default:
+      throw std::invalid_argument("bad memory size: " + text);
+    }
+  }
+  return static_cast<size_t>(std::stoull(text.substr(0, end))) << shift;
+}
+
+// in doubles, the state counts of a large formula overflow Index in
+// the 32 bit build
+size_t estimate_peak_memory
+(const std::vector<std::vector<Literal>>& clauses,
+ int num_vars,
+ int num_workers,
+ const ConsistencyOptions& options) {
+  // apply_constraints adds a term per literal past the third
+  double n = num_vars;
+  double clause_bytes = sizeof(clauses) +
+    clauses.capacity() * sizeof(clauses[0]);
+  for (const auto& clause : clauses) {
+    if (clause.size() > 3) {
+      n += clause.size() - 3;
+    }
+    clause_bytes += clause.capacity() * sizeof(Literal);
+  }
+  double terms = n;
+  double pairs = n * (n - 1) / 2;
+  double bases = n * (n - 1) * (n - 2) / 6;
+  bool dense = options.zero_page_states ||
+    options.state_backend == StateBackend::DENSE;
+  if (!dense) {
+    pairs = (pairs + 1) / 2;
+  }
+  if (!dense && options.state_backend == StateBackend::BIT) {
+    terms = (terms + 3) / 4;
+  }
+  // a spilled store's basis states are page cache the kernel can
+  // drop, an unspilled zero page one may still touch every page
+  if (options.zero_page_states && !options.spill_dir.empty()) {
+    bases = 0;
+  }
+  double copies = (num_workers > 1 && !options.shared_state) ?
+    num_workers + 1 : 1;
+  double peak = clause_bytes + copies * (terms + pairs + bases);
+
+  // the sequential engine and every copy-and-merge worker keep their
+  // own side arrays, a byte per state of the dense levels: the
+  // worklist two sets of marks over all three, skip_unconstrained a
+  // summary of the terms and bases
+  double engines = 1;
+  if (num_workers > 1) {
+    engines = (options.shared_state || options.work_stealing) ?
+      0 : num_workers;
+  }
+  double dense_pairs = n * (n - 1) / 2;
+  double dense_bases = n * (n - 1) * (n - 2) / 6;
+  double side = 0;
+  if (options.use_worklist) {
+    side += 2 * (n + dense_pairs + dense_bases) + n * sizeof(Index);
+  }
+  if (options.skip_unconstrained) {
+    side += n + dense_bases;
+  }
+  peak += engines * side;
+  // a combine cache on the calling thread and on every worker
+  double threads = (num_workers > 1) ? num_workers + 1 : 1;
+  peak += threads * combine_cache_bytes();
+
+  if (peak >= static_cast<double>(std::numeric_limits<size_t>::max())) {
+    return std::numeric_limits<size_t>::max();
+  }
+  return static_cast<size_t>(peak);
+}
+
+// KiB below 16 MiB so small budgets do not all read as 0 or 1 MiB
+static std::string size_text(size_t bytes) {
+  std::ostringstream out;
+  if (bytes < (16u << 20)) {
+    out << ((bytes + 1023) >> 10) << " KiB";
+  } else {
+    out << ((bytes + (1u << 20) - 1) >> 20) << " MiB";
+  }
+  return out.str();
+}
+
+// the packed and zero page stores run the plain or tiled sweep only
+static bool store_choice_allowed(const ConsistencyOptions& options) {
+  return !options.use_worklist && !options.skip_unconstrained &&
+    !options.row_propagation;
+}
+
+static std::string describe(int num_workers,
+			    const ConsistencyOptions& options) {
+  std::ostringstream out;
+  out << num_workers << (num_workers == 1 ? " worker" : " workers");
+  if (num_workers > 1 && options.shared_state) {
+    out << " sharing one store";
+  }
+  if (options.zero_page_states) {
+    out << ", zero page basis states";
+    if (!options.spill_dir.empty()) {
+      out << " spilled to " << options.spill_dir;
+    }
+  } else if (options.state_backend == StateBackend::NIBBLE) {
+    out << ", nibble store";
+  } else if (options.state_backend == StateBackend::BIT) {
+    out << ", bit store";
+  }
+  return out.str();
+}
+
+void plan_memory(const std::vector<std::vector<Literal>>& clauses,
+		 int num_vars,
+		 int& num_workers,
+		 ConsistencyOptions& options) {
+  size_t budget = options.max_memory ? options.max_memory :
+    cgroup_memory_limit();
+  if (budget == 0) {
+    return;
+  }
+  size_t asked = estimate_peak_memory(clauses, num_vars, num_workers,
+				      options);
+  std::cout << "- Memory budget: " << size_text(budget)
+	    << ", estimated peak " << size_text(asked) << std::endl;
+  if (asked <= budget) {
+    return;
+  }
+  // the store asked for, then the smaller ones it may give way to
+  std::vector<ConsistencyOptions> stores(1, options);
+  if (store_choice_allowed(options)) {
+    ConsistencyOptions smaller = options;
+    if (!options.zero_page_states) {
+      if (options.state_backend == StateBackend::DENSE) {
+	smaller.state_backend = StateBackend::NIBBLE;
+	stores.push_back(smaller);
+      }
+      if (options.state_backend != StateBackend::BIT) {
+	smaller.state_backend = StateBackend::BIT;
+	stores.push_back(smaller);
+      }
+    }
+    if (options.spill_dir.empty()) {
+      smaller.state_backend = StateBackend::DENSE;
+      smaller.zero_page_states = true;
+      const char* tmpdir = std::getenv("TMPDIR");
+      smaller.spill_dir = tmpdir ? tmpdir : "/var/tmp";
+      if (smaller.tile_terms == 0) {
+	smaller.tile_terms = 32;
+      }
+      stores.push_back(smaller);
+    }
+  }
+  size_t smallest = asked;
+  for (size_t s = 0; s < stores.size(); ++s) {
+    ConsistencyOptions store = stores[s];
+    // only copy-and-merge runs the stores we switch to in parallel
+    if (s > 0) {
+      store.shared_state = false;
+      store.work_stealing = false;
+    }
+    // as many workers as fit, sharing one store before giving up on
+    // parallelism
+    std::vector<std::pair<int, bool>> tries;
+    for (int workers = num_workers; workers > 1; --workers) {
+      tries.push_back(std::make_pair(workers, store.shared_state));
+    }
+    if (num_workers > 1 && !store.shared_state && !store.zero_page_states &&
+	store.state_backend == StateBackend::DENSE) {
+      tries.push_back(std::make_pair(num_workers, true));
+    }
+    tries.push_back(std::make_pair(1, store.shared_state));
+    for (const auto& attempt : tries) {
+      ConsistencyOptions planned = store;
+      planned.shared_state = attempt.second;
+      size_t peak = estimate_peak_memory(clauses, num_vars, attempt.first,
+					 planned);
+      smallest = std::min(smallest, peak);
+      if (peak <= budget) {
+	std::cout << "- Memory plan: " << describe(attempt.first, planned)
+		  << ", estimated peak " << size_text(peak) << std::endl;
+	num_workers = attempt.first;
+	options = planned;
+	return;
+      }
+    }
+  }
+  std::ostringstream message;
+  message << "the solve needs about " << size_text(smallest)
+	  << " at the least";
+  if (!store_choice_allowed(options)) {
+    message << " with --worklist, --skip-unconstrained or "
+	    << "--row-propagation";
+  }
+  message << ", over the " << size_text(budget) << " budget";
+  throw std::runtime_error(message.str());
+}
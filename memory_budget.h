@@ -0,0 +1,71 @@
+// MIT License
+
+// Copyright (c) 2025 Daniel Issen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// How much memory a solve needs, and how to make it fit.  the states
+// grow with the cube of the terms, so a formula that does not fit
+// used to run until the OOM killer found it part way through a
+// sweep.  check_satisfiability now estimates its peak before it
+// allocates anything and compares that with options.max_memory, or
+// the cgroup limit.  if the run asked for does not fit it moves down
+// this list until one does:
+//
+//   fewer workers   copy-and-merge keeps one store per worker plus
+//                   the one it merges into
+//   shared state    every worker prunes the same dense store
+//   one worker
+//   nibble, bit     the packed stores of state_store.h
+//   spilled         basis states in a file (see zero_page_states.h)
+//
+// and fails before allocating if even that is too big.  the packed
+// and spilled stores are only tried when the other options allow
+// them.
+
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "file_parser.h"
+#include "basis_consistency.h"
+
+// The memory limit of our cgroup, v2 or v1.  0 if there is none.
+size_t cgroup_memory_limit();
+
+// Bytes in a size like 1048576, 512K, 64M or 8G.  throws
+// std::invalid_argument if text is not one.
+size_t parse_memory_size(const std::string& text);
+
+// Peak bytes a solve of clauses over num_vars variables takes with
+// num_workers workers and options, the clauses, the engines' side
+// arrays and the combine caches included
+size_t estimate_peak_memory
+(const std::vector<std::vector<Literal>>& clauses,
+ int num_vars,
+ int num_workers,
+ const ConsistencyOptions& options);
+
+// Change num_workers and options so the solve fits the budget,
+// printing the plan.  does nothing without a budget and throws
+// std::runtime_error if nothing fits.
+void plan_memory(const std::vector<std::vector<Literal>>& clauses,
+		 int num_vars,
+		 int& num_workers,
+		 ConsistencyOptions& options);
@@ -22,31 +22,50 @@
 
 #include "pairing.h"
 #include <cmath>
+#include <algorithm>
 
 /**
- * @brief Maps a pair of indices (i,j) where i < j to a unique single index
- * 
- * This function implements a pairing function that generates a unique index for
- * each unique pair of indices (i,j) where i < j, allowing us to store
- * pair-based data in a flat array. This is particularly useful for
- * storing pair_states in the 3SAT solver algorithm.
- * 
- * The formula used is based on the triangular number formula: (j * (j
- * - 1)) / 2 + i 
- * 
- * For example:
- * - pair2d(0,1) = (1 * (1 - 1)) / 2 + 0 = 0
- * - pair2d(0,2) = (2 * (2 - 1)) / 2 + 0 = 1
- * - pair2d(1,2) = (2 * (2 - 1)) / 2 + 1 = 2
- * - pair2d(0,3) = (3 * (3 - 1)) / 2 + 0 = 3
- * - and so on...
- * 
- * @param i First index (must be less than j)
- * @param j Second index (must be greater than i)
- * @return Index A unique index for the pair
+ * @brief Fills the triangular and tetrahedral tables at compile time
+ *
+ * pair2d(0,j) = C(j,2) = j * (j - 1) / 2 and pair3d(0,1,k) = C(k,3) =
+ * k * (k - 1) * (k - 2) / 6, so for example row j = 3 of pair2d starts
+ * at 3 and slab k = 4 of pair3d starts at 4.  Both are prefix sums: a
+ * row holds j pairs and a slab holds C(k,2) bases.
+ */
+static constexpr PairingTables build_pairing_tables() {
+    PairingTables tables{};
+    for (Index n = 1; n < PAIRING_TABLE_TERMS; ++n) {
+        tables.triangular[n] = tables.triangular[n - 1] + (n - 1);
+        tables.tetrahedral[n] = tables.tetrahedral[n - 1] +
+            tables.triangular[n - 1];
+    }
+    return tables;
+}
+
+const PairingTables pairing_tables = build_pairing_tables();
+
+/**
+ * @brief Floor of the square root of x, exact for every Index width
+ *
+ * The double estimate is within a unit of the root for values up to
+ * 64 bits and one step each way with exact integer products puts it
+ * on the root.  A wider value can be thousands off, so it first
+ * takes a Newton step, which leaves it on or a unit above the root.
+ * Capping the estimate at ROOT_MAX keeps r * r from overflowing.
+ * Single steps rather than loops keep the correction branch free.
  */
-Index pair2d(Index i, Index j) {
-    return (j * (j - 1)) / 2 + i;
+static Index integer_sqrt(Index x) {
+    constexpr Index ROOT_MAX = (Index(1) << (INDEX_BITS / 2)) - 1;
+    Index r = static_cast<Index>(std::sqrt(static_cast<double>(x)));
+#if INDEX_BITS > 64
+    if (x >> 64) {
+        r = (r + x / r) / 2;
+    }
+#endif
+    r = std::min(r, ROOT_MAX);
+    r -= r * r > x;
+    r += r < ROOT_MAX && (r + 1) * (r + 1) <= x;
+    return r;
 }
 
 /**
@@ -58,56 +77,22 @@ Index pair2d(Index i, Index j) {
  * when we need to identify which specific pair corresponds to a given index
  * in the flat pair_states array.
  * 
- * The algorithm works as follows:
- * 1. Find j by solving the quadratic equation: (j * (j - 1)) / 2 ≤
- *  index < (j * (j + 1)) / 2 
- * 2. Once j is found, compute i = index - (j * (j - 1)) / 2
+ * j is the largest value with C(j,2) <= index, i.e. j * (j - 1) <= 2 *
+ * index.  With s = floor(sqrt(2 * index)) that is s + 1 if C(s+1,2)
+ * still fits below index and s otherwise.  Everything is integer
+ * arithmetic so the result is exact over the whole Index range,
+ * including the basis pair indices past 2^53 where a double no
+ * longer holds the index.
  * 
  * @param index The flat array index to convert back to a pair
  * @return std::tuple<Index, Index> The original (i,j) pair
  */
 std::tuple<Index, Index> unpair2d(Index index) {
-    // Compute discriminant for the quadratic formula
-    double discriminant = 1.0 + 8.0 * index;
-    
-    // Use the quadratic formula to get an approximation of j
-    // j ≈ (1 + √(1 + 8*index)) / 2
-    double j_approx = (1.0 + std::sqrt(discriminant)) / 2.0;
-    Index j = static_cast<Index>(j_approx);
-    
-    // Refine the estimate of j to ensure it's correct
-    // Adjust j downward if needed
-    while ((j * (j - 1)) / 2 > index) j--;
-    
-    // Adjust j upward if needed
-    while ((j + 1) * j / 2 <= index) j++;
-    
-    // Calculate i using the relationship index = (j * (j - 1)) / 2 + i
-    Index i = index - (j * (j - 1)) / 2;
-    
-    return std::make_tuple(i, j);
-}
-
-/**
- * @brief Maps a triplet of indices (i,j,k) where i < j < k to a
- * unique single index 
- * 
- * This function is an extension of pair2d for three indices. It
- * generates a unique index for each unique triplet of indices (i,j,k)
- * where i < j < k. This allows us to store triplet-based data (basis
- * states) in a flat array. 
- * 
- * The formula uses a combination of the triangular number and
- * tetrahedral number 
- * formulas: (k * (k - 1) * (k - 2)) / 6 + (j * (j - 1)) / 2 + i
- * 
- * @param i First index (must be less than j)
- * @param j Second index (must be between i and k)
- * @param k Third index (must be greater than j)
- * @return Index A unique index for the triplet
- */
-Index pair3d(Index i, Index j, Index k) {
-    return (k * (k - 1) * (k - 2)) / 6 + (j * (j - 1)) / 2 + i;
+    Index j = integer_sqrt(2 * index);
+    // s + 1 is right about half the time, so add the comparison
+    // rather than branch on it
+    j += ((j + 1) * j) / 2 <= index;
+    return std::make_tuple(index - (j * (j - 1)) / 2, j);
 }
 
 /**
@@ -121,44 +106,62 @@ Index pair3d(Index i, Index j, Index k) {
  * flat basis_states array. 
  * 
  * The algorithm works as follows:
- * 1. Find k by solving the cubic equation: (k * (k - 1) * (k - 2)) / 6 ≤ index
+ * 1. Find the slab k, the largest k with C(k,3) <= index, by binary
+ *    search in the tetrahedral table.  Indices past the table start
+ *    from a cube root estimate corrected with exact C(k,3)s
  * 2. Calculate the remaining index after removing k's contribution
- * 3. Use unpair2d's logic to recover j and i from the remaining index
+ * 3. Recover (i,j) from the remaining index with unpair2d
  * 
  * @param index The flat array index to convert back to a triplet
  * @return std::tuple<Index, Index, Index> The original (i,j,k) triplet
  */
 std::tuple<Index, Index, Index> unpair3d(Index index) {
-    // Approximate k using the cube root formula
-    // This is an approximation for solving (k * (k - 1) * (k - 2)) / 6 = index
-    double k_approx = std::cbrt(6.0 * index);
-    Index k = static_cast<Index>(k_approx);
-    
-    // Refine the estimate of k to ensure it's correct
-    // Adjust k downward if needed
-    while ((k * (k - 1) * (k - 2)) / 6 > index) k--;
-    
-    // Adjust k upward if needed
-    while ((k + 1) * k * (k - 1) / 6 <= index) k++;
-    
-    // Calculate the remaining index after removing k's contribution
-    Index remaining = index - (k * (k - 1) * (k - 2)) / 6;
-    
-    // Use the same approach as unpair2d to recover j and i
-    double discriminant = 1.0 + 8.0 * remaining;
-    double j_approx = (1.0 + std::sqrt(discriminant)) / 2.0;
-    Index j = static_cast<Index>(j_approx);
-    
-    // Refine the estimate of j
-    while ((j * (j - 1)) / 2 > remaining) j--;
-    while ((j + 1) * j / 2 <= remaining) j++;
-    
-    // Calculate i using the relationship remaining = (j * (j - 1)) / 2 + i
-    Index i = remaining - (j * (j - 1)) / 2;
+    const Index* table = pairing_tables.tetrahedral;
+    Index k = 0;
+    if (index < table[PAIRING_TABLE_TERMS - 1]) {
+        // PAIRING_TABLE_TERMS is a power of two, so halving steps
+        // reach every entry.  the steps compile to conditional moves
+        // rather than hard to predict branches.
+        for (Index step = PAIRING_TABLE_TERMS / 2; step > 0; step /= 2) {
+            k += table[k + step] <= index ? step : 0;
+        }
+    } else {
+        k = static_cast<Index>(std::cbrt(6.0 * static_cast<double>(index)));
+        k = std::max(k, PAIRING_TABLE_TERMS - 1);
+        while (tetrahedral(k) > index) k--;
+        while (tetrahedral(k + 1) <= index) k++;
+    }
     
+    Index remaining = index - tetrahedral(k);
+    Index i, j;
+    std::tie(i, j) = unpair2d(remaining);
     return std::make_tuple(i, j, k);
 }
 
+/**
+ * @brief Positions a BasisPairIterator on an arbitrary basis pair
+ *
+ * This is the only place the iterator unpairs.  Segments handed out
+ * by divide_work and the restarts in determine_solution begin at an
+ * arbitrary offset so we unpair once here and let next() walk from
+ * there incrementally.
+ *
+ * @param basis_pair The pair2d index of (basis1, basis2)
+ */
+BasisPairIterator::BasisPairIterator(Index basis_pair)
+  : basis_pair_(basis_pair) {
+    BasisPair& bp = current_;
+    std::tie(bp.basis1_idx, bp.basis2_idx) = unpair2d(basis_pair);
+    std::tie(bp.i1, bp.j1, bp.k1) = unpair3d(bp.basis1_idx);
+    std::tie(bp.i2, bp.j2, bp.k2) = unpair3d(bp.basis2_idx);
+    bp.ij1_idx = pair2d(bp.i1, bp.j1);
+    bp.ik1_idx = pair2d(bp.i1, bp.k1);
+    bp.jk1_idx = pair2d(bp.j1, bp.k1);
+    bp.ij2_idx = pair2d(bp.i2, bp.j2);
+    bp.ik2_idx = pair2d(bp.i2, bp.k2);
+    bp.jk2_idx = pair2d(bp.j2, bp.k2);
+}
+
 /**
  * @brief Calculates the array size needed to store all pairs (i,j)
  * where i < j < n 
@@ -195,3 +198,40 @@ Index calculate_array_size_2d(Index n) {
 Index calculate_array_size_3d(Index n) {
     return (n * (n - 1) * (n - 2)) / 6;
 }
+
+/**
+ * @brief Whether Index can hold every index the engine computes for n
+ * terms
+ *
+ * The largest intermediate values are the products n * (n - 1) *
+ * (n - 2) behind C(n,3) and b * (b - 1) behind the C(b,2) basis pairs
+ * of b = C(n,3) bases.
+ *
+ * @param n Number of terms, auxiliary variables included
+ * @return bool False if this build's Index would overflow
+ */
+bool index_range_fits(Index n) {
+    if (n < 3) {
+        return true;
+    }
+    Index product;
+    if (__builtin_mul_overflow(n, n - 1, &product) ||
+        __builtin_mul_overflow(product, n - 2, &product)) {
+        return false;
+    }
+    Index num_bases = product / 6;
+    return !__builtin_mul_overflow(num_bases, num_bases - 1, &product);
+}
+
+#if INDEX_BITS == 128
+std::ostream& operator<<(std::ostream& out, __uint128_t value) {
+    char digits[40];
+    int pos = sizeof(digits);
+    digits[--pos] = '\0';
+    do {
+        digits[--pos] = '0' + static_cast<int>(value % 10);
+        value /= 10;
+    } while (value);
+    return out << &digits[pos];
+}
+#endif
@@ -29,25 +29,146 @@
 #pragma once
 #include <tuple>
 #include <cstdint>
+#include <ostream>
 
-#if 0
+// Width of Index, chosen at build time with make INDEX_BITS=32, 64 or
+// 128.  the basis pair indices of n terms go up to C(C(n,3),2), which
+// outgrows 32 bits past 74 terms and 64 bits past 2954 terms; see
+// index_range_fits.
+#ifndef INDEX_BITS
+#define INDEX_BITS 64
+#endif
+
+#if INDEX_BITS == 32
+typedef uint32_t Index;
+#elif INDEX_BITS == 64
+typedef uint64_t Index;
+#elif INDEX_BITS == 128
 typedef __uint128_t Index;
+// iostreams have no 128 bit integers
+std::ostream& operator<<(std::ostream& out, __uint128_t value);
 #else
-typedef uint64_t Index;
+#error "INDEX_BITS must be 32, 64 or 128"
 #endif
 
-// Maps (i,j) where i < j to a unique index
-Index pair2d(Index i, Index j);
+// C(j,2) and C(k,3) for the first PAIRING_TABLE_TERMS terms, the row
+// and slab starts of pair2d and pair3d.  this covers every term index
+// a 64 bit build can address; 32 bit builds stop before C(k,3) wraps.
+#if INDEX_BITS == 32
+constexpr Index PAIRING_TABLE_TERMS = 1024;
+#else
+constexpr Index PAIRING_TABLE_TERMS = 4096;
+#endif
+struct PairingTables {
+  Index triangular[PAIRING_TABLE_TERMS];
+  Index tetrahedral[PAIRING_TABLE_TERMS];
+};
+extern const PairingTables pairing_tables;
+
+// C(j,2), where row j of the pairs starts
+inline Index triangular(Index j) {
+  return j < PAIRING_TABLE_TERMS ?
+    pairing_tables.triangular[j] : (j * (j - 1)) / 2;
+}
+
+// C(k,3), where slab k of pair3d starts
+inline Index tetrahedral(Index k) {
+  return k < PAIRING_TABLE_TERMS ?
+    pairing_tables.tetrahedral[k] : (k * (k - 1) * (k - 2)) / 6;
+}
+
+// Maps (i,j) where i < j to a unique index.  plain arithmetic: a
+// multiply and a shift beat the triangular table load here.
+inline Index pair2d(Index i, Index j) {
+  return (j * (j - 1)) / 2 + i;
+}
 
 // Maps index back to (i,j) where i < j
 std::tuple<Index, Index> unpair2d(Index index);
 
-// Maps (i,j,k) where i < j < k to a unique index
-Index pair3d(Index i, Index j, Index k);
-
 // Maps index back to (i,j,k) where i < j < k
 std::tuple<Index, Index, Index> unpair3d(Index index);
 
 // Helper functions to calculate total array sizes
 Index calculate_array_size_2d(Index n); // N Choose 2
 Index calculate_array_size_3d(Index n); // N Choose 3
+
+// False if n terms need a wider Index than this build has
+bool index_range_fits(Index n);
+
+// Maps (i,j,k) where i < j < k to a unique index.  the bases are in
+// colex order: every basis with largest term k sits in one slab
+// starting at C(k,3), so the prefix [0, C(n,3)) holds exactly the
+// bases of the first n terms.
+inline Index pair3d(Index i, Index j, Index k) {
+  return tetrahedral(k) + triangular(j) + i;
+}
+
+// A pair of bases with their terms and pair indices unpacked.
+// basis1 < basis2 as produced by unpair2d.
+struct BasisPair {
+  Index basis1_idx, basis2_idx;
+  Index i1, j1, k1;
+  Index i2, j2, k2;
+  Index ij1_idx, ik1_idx, jk1_idx;
+  Index ij2_idx, ik2_idx, jk2_idx;
+};
+
+// Walks the basis pairs in the same order as unpair2d over
+// consecutive indices without unpairing each step.  basis1 is the
+// fast moving basis, basis2 and its pair indices stay fixed until
+// basis1 wraps around.
+class BasisPairIterator {
+public:
+  // Start at an arbitrary basis pair index
+  explicit BasisPairIterator(Index basis_pair);
+
+  Index basis_pair() const { return basis_pair_; }
+  const BasisPair& current() const { return current_; }
+
+  // Advance to basis_pair() + 1
+  void next() {
+    ++basis_pair_;
+    ++current_.basis1_idx;
+    if (current_.basis1_idx == current_.basis2_idx) {
+      // basis1 wrapped, start over at (0,1,2) against the next basis2
+      ++current_.basis2_idx;
+      advance_basis(current_.i2, current_.j2, current_.k2,
+		    current_.ij2_idx, current_.ik2_idx, current_.jk2_idx);
+      current_.basis1_idx = 0;
+      current_.i1 = 0; current_.j1 = 1; current_.k1 = 2;
+      current_.ij1_idx = 0; current_.ik1_idx = 1; current_.jk1_idx = 2;
+      return;
+    }
+    advance_basis(current_.i1, current_.j1, current_.k1,
+		  current_.ij1_idx, current_.ik1_idx, current_.jk1_idx);
+  }
+
+  // Step (i,j,k) to the next basis in pair3d order keeping the pair
+  // indices of (i,j), (i,k) and (j,k) up to date
+  static void advance_basis(Index& i, Index& j, Index& k,
+			    Index& ij_idx, Index& ik_idx, Index& jk_idx) {
+    if (i + 1 < j) {
+      // only i moves, (i,j) and (i,k) are the next pair indices
+      ++i;
+      ++ij_idx;
+      ++ik_idx;
+      return;
+    }
+    i = 0;
+    if (j + 1 < k) {
+      ++j;
+      ++jk_idx;
+    } else {
+      j = 1;
+      ++k;
+      jk_idx = pair2d(j, k);
+    }
+    ij_idx = pair2d(i, j);
+    ik_idx = pair2d(i, k);
+  }
+
+private:
+  Index basis_pair_;
+  BasisPair current_;
+};
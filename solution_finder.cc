@@ -23,6 +23,7 @@
 #include "solution_finder.h"
 #include "basis_consistency.h"
 #include "pairing.h"
+#include "basis_rows.h"
 #include "constants.h"
 #include <fstream>
 #include <iostream>
@@ -81,114 +82,116 @@ bool validate_solution(const SATSolution& solution,
   return true;
 }
 
-SATSolution determine_solution
-(std::vector<uint8_t>& basis_states,
- std::vector<uint8_t>& pair_states,
- std::vector<uint8_t>& term_states,
- Index n,
- int num_workers) {
+// Propagate the basis picked at starting_position: a quick pass of
+// updating each basis a row at a time, then the global engine from
+// the picked basis on.  a contradiction of the row pass shows up
+// again in the global pass.
+template <typename Store>
+static void propagate_choice(Store& states,
+			     Index starting_position,
+			     Index starting_basis_pair,
+			     Index ending_basis_pair,
+			     int num_workers,
+			     const ConsistencyOptions& options) {
+  bool row_contradiction = false;
+  sweep_basis_rows(states, row_contradiction, starting_position);
+
+  bool has_contradiction = false;
+  if(num_workers < 2) {
+    ensure_global_consistency(states,
+			      has_contradiction,
+			      starting_basis_pair,
+			      ending_basis_pair,
+			      options);
+  } else {
+    parallel_ensure_global_consistency(states,
+				       has_contradiction,
+				       starting_basis_pair,
+				       ending_basis_pair,
+				       num_workers,
+				       options);
+  }
+}
+
+template <typename Store>
+SATSolution determine_solution(Store& states,
+			       Index n,
+			       int num_workers,
+			       const ConsistencyOptions& options) {
 
   std::cout << "Attempting to determine a solution..." << std::endl;
   auto start = std::chrono::high_resolution_clock::now();
     
+  const Index num_terms = states.num_terms();
   Index i = 0;
   Index j = i + 1;
   Index k = j + 1;
   
   // set three terms at a time
   Index starting_position = 0;
-  for(i = 0; i < term_states.size() - 2; i += 3) {
+  for(i = 0; i < num_terms - 2; i += 3) {
     j = i + 1;
     k = j + 1;
     Index basis_idx = pair3d(i,j,k);
-    uint8_t current_state = basis_states[basis_idx];
+    uint8_t current_state = states.bases[basis_idx];
     // if the basis is either already fixed or trivially fixed,
     // continue to the next.
     update_basis_states(i, j, k,
 			basis_idx,
-			term_states, 
-			pair_states, 
-			basis_states);
+			states.terms,
+			states.pairs,
+			states.bases);
     if(0 == (current_state & (current_state -1))) {
       continue;			// only one bit is set we can skip to
 				// the next basis.
     }
     // pick the first valid solution
-    basis_states[basis_idx] =
-      basis_states[basis_idx] & -basis_states[basis_idx];
-
-    // do a quick pass of updating each basis
-    bool changed = false;
-    do {
-      changed = false;
-      for(Index basis_index = starting_position;
-	  basis_index < basis_states.size();
-	  ++basis_index) {
-	std::tuple<Index,Index,Index> ijk = unpair3d(basis_index);
-	UpdateResult result =
-	  update_basis_states(std::get<0>(ijk),
-			      std::get<1>(ijk),
-			      std::get<2>(ijk),
-			      basis_index,
-			      term_states,
-			      pair_states,
-			      basis_states);
-	if(result.changed) {
-	  changed = true;
-	}
-      }
-    } while(changed);
+    uint8_t basis_state = states.basis(i, j, k);
+    states.narrow_basis(i, j, k, basis_state & -basis_state);
 
     Index starting_basis_pair =
       pair2d(starting_position,starting_position + 1);
     Index ending_basis_pair =
       calculate_array_size_2d(calculate_array_size_3d(n));
-    bool has_contradiction = false;
-    if(num_workers < 2) {
-      ensure_global_consistency(term_states,
-				pair_states,
-				basis_states,
-				has_contradiction,
-				starting_basis_pair,
-				ending_basis_pair);
-    } else {
-      parallel_ensure_global_consistency(term_states,
-					 pair_states,
-					 basis_states,
-					 has_contradiction,
-					 starting_basis_pair,
-					 ending_basis_pair,
-					 num_workers);
+    propagate_choice(states,
+		     starting_position,
+		     starting_basis_pair,
+		     ending_basis_pair,
+		     num_workers,
+		     options);
+    if(engine_stop_reason() != StopReason::NONE) {
+      break;
     }
     starting_position = basis_idx;
   }
   SATSolution solution;
   solution.assignments.resize(n, 0);  // Initialize all as unassigned
+  if(engine_stop_reason() != StopReason::NONE) {
+    return solution;		// stopped early, leave everything unassigned
+  }
   // we may have 1-2 terms still unset.
   j = i + 1;
-  if(j < term_states.size()) { // two terms unset
+  if(j < num_terms) { // two terms unset
     // update the pair based on its terms
-    update_pair_states(i,j,term_states,pair_states);
-    Index pair_idx = pair2d(i,j);
-    uint8_t current_state = pair_states[pair_idx];
+    update_pair_states(i,j,states.terms,states.pairs);
+    uint8_t current_state = states.pair(i,j);
     if(!current_state) {
       std::cout << "this shouldn't happen" << std::endl;
       exit(0);
     }
     // pick the first valid solution
-    pair_states[pair_idx] =
-      pair_states[pair_idx] & -pair_states[pair_idx];
-    update_pair_states(i,j,term_states,pair_states);
-  } else if(i < term_states.size()) {
-    if(term_states[i] == SET_ANY) { // one term unset
-      term_states[i] = SET_POS;
-    } else if(0 == term_states[i]) {
+    states.narrow_pair(i, j, current_state & -current_state);
+    update_pair_states(i,j,states.terms,states.pairs);
+  } else if(i < num_terms) {
+    if(states.term(i) == SET_ANY) { // one term unset
+      states.narrow_term(i, SET_POS);
+    } else if(0 == states.term(i)) {
       std::cout << "this shouldn't happen" << std::endl;
     }
   }
   // Extract the solution from term_states
   for (Index i = 0; i < n; i++) {
-    uint8_t state = term_states[i];
+    uint8_t state = states.term(i);
         
     if (state == SET_NEG) {
       solution.assignments[i] = -1;  // Negative assignment
@@ -212,6 +215,11 @@ SATSolution determine_solution
   return solution;
 }
 
+#define INSTANTIATE_DETERMINE_SOLUTION(Store)				\
+  template SATSolution determine_solution(Store&, Index, int,		\
+					  const ConsistencyOptions&);
+FOR_EACH_STATE_STORE(INSTANTIATE_DETERMINE_SOLUTION)
+
 void print_solution(const SATSolution& solution) {
   std::cout << "Solution:" << std::endl;
   for (size_t i = 0; i < solution.assignments.size(); i++) {
@@ -38,12 +38,14 @@ struct SATSolution {
 bool validate_solution(const SATSolution& solution, 
                        const std::vector<std::vector<Literal>>& cnf_clauses);
 
-// Function to determine a solution from the current states
-SATSolution determine_solution(std::vector<uint8_t>& basis_states,
-			       std::vector<uint8_t>& pair_states,
-			       std::vector<uint8_t>& term_states,
+// Function to determine a solution from the current states, for
+// every store FOR_EACH_STATE_STORE names
+template <typename Store>
+SATSolution determine_solution(Store& states,
 			       Index n,
-			       int num_workers);
+			       int num_workers,
+			       const ConsistencyOptions& options =
+			       ConsistencyOptions());
 
 // Helper function to save solution to a file
 bool save_solution_to_file(const SATSolution& solution,
@@ -0,0 +1,325 @@
+// MIT License
+
+// Copyright (c) 2025 Daniel Issen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Byte states in SIMD lanes.  a lane policy L wraps one vector of
+// L::WIDTH byte states (16 for SSSE3, 32 for AVX2, 64 for AVX-512BW,
+// 1 without any of them) and the handful of operations the row sweep
+// and the batch engine need, with pshufb as a 16 entry table lookup.
+// NativeLanes is the widest one the target supports.
+//
+// only included by lane_kernels.inc, which is built once per target,
+// so everything is in an anonymous namespace to keep the copies apart.
+
+#pragma once
+#include <cstdint>
+#include "constants.h"
+#include "pairing.h"
+#if defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// 16 entry lookup tables, one byte shuffle each.  term states and
+// pair states are at most 15 and basis states are looked up a nibble
+// at a time, which works because every projection below is an OR
+// over the bits of its input.
+//
+// bit a of a term is its value (0 = NEG, 1 = POS), bit a*2+b of a
+// pair and bit a*4+b*2+c of a basis are the values of their terms.
+struct LaneTables {
+  // term -> pairs/bases where that term is first, second or third
+  alignas(16) uint8_t first_pairs[16];
+  alignas(16) uint8_t second_pairs[16];
+  alignas(16) uint8_t basis_i[16];
+  alignas(16) uint8_t basis_j[16];
+  alignas(16) uint8_t basis_k[16];
+  // pair -> bases agreeing with it
+  alignas(16) uint8_t ij_basis[16];
+  alignas(16) uint8_t ik_basis[16];
+  alignas(16) uint8_t jk_basis[16];
+  // low and high basis nibble -> pairs they project to
+  alignas(16) uint8_t ij_low[16];
+  alignas(16) uint8_t ij_high[16];
+  alignas(16) uint8_t ik_low[16];
+  alignas(16) uint8_t ik_high[16];
+  alignas(16) uint8_t jk_low[16];
+  alignas(16) uint8_t jk_high[16];
+  // pair -> values of its first or second term
+  alignas(16) uint8_t first_terms[16];
+  alignas(16) uint8_t second_terms[16];
+};
+
+constexpr LaneTables build_lane_tables() {
+  LaneTables tables{};
+  for (int s = 0; s < 16; s++) {
+    for (int a = 0; a < 2; a++) {
+      for (int b = 0; b < 2; b++) {
+	uint8_t pair_bit = 1 << (a * 2 + b);
+	if (s & (1 << a)) {
+	  tables.first_pairs[s] |= pair_bit;
+	}
+	if (s & (1 << b)) {
+	  tables.second_pairs[s] |= pair_bit;
+	}
+	if (s & pair_bit) {
+	  tables.first_terms[s] |= 1 << a;
+	  tables.second_terms[s] |= 1 << b;
+	}
+	for (int c = 0; c < 2; c++) {
+	  int v = a * 4 + b * 2 + c;
+	  uint8_t basis_bit = 1 << v;
+	  if (s & (1 << a)) tables.basis_i[s] |= basis_bit;
+	  if (s & (1 << b)) tables.basis_j[s] |= basis_bit;
+	  if (s & (1 << c)) tables.basis_k[s] |= basis_bit;
+	  if (s & (1 << (a * 2 + b))) tables.ij_basis[s] |= basis_bit;
+	  if (s & (1 << (a * 2 + c))) tables.ik_basis[s] |= basis_bit;
+	  if (s & (1 << (b * 2 + c))) tables.jk_basis[s] |= basis_bit;
+	  // s as the low (v < 4) or high (v >= 4) nibble of a basis
+	  if (((v < 4) ? s : s << 4) & basis_bit) {
+	    if (v < 4) {
+	      tables.ij_low[s] |= 1 << (a * 2 + b);
+	      tables.ik_low[s] |= 1 << (a * 2 + c);
+	      tables.jk_low[s] |= 1 << (b * 2 + c);
+	    } else {
+	      tables.ij_high[s] |= 1 << (a * 2 + b);
+	      tables.ik_high[s] |= 1 << (a * 2 + c);
+	      tables.jk_high[s] |= 1 << (b * 2 + c);
+	    }
+	  }
+	}
+      }
+    }
+  }
+  return tables;
+}
+
+constexpr LaneTables lane_tables = build_lane_tables();
+
+// One state at a time, for targets without byte shuffles
+struct ScalarLanes {
+  typedef uint8_t Vec;
+  static constexpr Index WIDTH = 1;
+  static Vec load(const uint8_t* p) { return *p; }
+  static void store(uint8_t* p, Vec v) { *p = v; }
+  static Vec broadcast(uint8_t x) { return x; }
+  static Vec lookup(const uint8_t* table, Vec index) { return table[index]; }
+  static Vec low_nibble(Vec v) { return v & 0x0F; }
+  static Vec high_nibble(Vec v) { return v >> 4; }
+  static Vec vand(Vec a, Vec b) { return a & b; }
+  static Vec vor(Vec a, Vec b) { return a | b; }
+  static bool any_zero(Vec v) { return !v; }
+  static bool differs(Vec a, Vec b) { return a != b; }
+  static uint8_t and_reduce(Vec v) { return v; }
+  // bit l set for every lane l that is zero or differs
+  static uint64_t zero_lanes(Vec v) { return !v; }
+  static uint64_t changed_lanes(Vec a, Vec b) { return a != b; }
+};
+
+#if defined(__SSSE3__)
+struct SsseLanes {
+  typedef __m128i Vec;
+  static constexpr Index WIDTH = 16;
+  static Vec load(const uint8_t* p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  }
+  static void store(uint8_t* p, Vec v) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+  }
+  static Vec broadcast(uint8_t x) { return _mm_set1_epi8(x); }
+  static Vec lookup(const uint8_t* table, Vec index) {
+    return _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>
+					   (table)), index);
+  }
+  static Vec low_nibble(Vec v) {
+    return _mm_and_si128(v, _mm_set1_epi8(0x0F));
+  }
+  static Vec high_nibble(Vec v) {
+    return _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0F));
+  }
+  static Vec vand(Vec a, Vec b) { return _mm_and_si128(a, b); }
+  static Vec vor(Vec a, Vec b) { return _mm_or_si128(a, b); }
+  static bool any_zero(Vec v) {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128()));
+  }
+  static bool differs(Vec a, Vec b) {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) != 0xFFFF;
+  }
+  static uint64_t zero_lanes(Vec v) {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128()));
+  }
+  static uint64_t changed_lanes(Vec a, Vec b) {
+    return ~_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) & 0xFFFF;
+  }
+  static uint8_t and_reduce(Vec v) {
+    v = _mm_and_si128(v, _mm_srli_si128(v, 8));
+    v = _mm_and_si128(v, _mm_srli_si128(v, 4));
+    v = _mm_and_si128(v, _mm_srli_si128(v, 2));
+    v = _mm_and_si128(v, _mm_srli_si128(v, 1));
+    return _mm_cvtsi128_si32(v) & 0xFF;
+  }
+};
+#endif
+
+#if defined(__AVX2__)
+// vpshufb looks up within each 128 bit half, so the tables are
+// broadcast to both halves
+struct Avx2Lanes {
+  typedef __m256i Vec;
+  static constexpr Index WIDTH = 32;
+  static Vec load(const uint8_t* p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+  }
+  static void store(uint8_t* p, Vec v) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+  }
+  static Vec broadcast(uint8_t x) { return _mm256_set1_epi8(x); }
+  static Vec lookup(const uint8_t* table, Vec index) {
+    return _mm256_shuffle_epi8(_mm256_broadcastsi128_si256
+			       (_mm_load_si128(reinterpret_cast
+					       <const __m128i*>(table))),
+			       index);
+  }
+  static Vec low_nibble(Vec v) {
+    return _mm256_and_si256(v, _mm256_set1_epi8(0x0F));
+  }
+  static Vec high_nibble(Vec v) {
+    return _mm256_and_si256(_mm256_srli_epi16(v, 4),
+			    _mm256_set1_epi8(0x0F));
+  }
+  static Vec vand(Vec a, Vec b) { return _mm256_and_si256(a, b); }
+  static Vec vor(Vec a, Vec b) { return _mm256_or_si256(a, b); }
+  static bool any_zero(Vec v) {
+    return _mm256_movemask_epi8(_mm256_cmpeq_epi8(v,
+						  _mm256_setzero_si256()));
+  }
+  static bool differs(Vec a, Vec b) {
+    return _mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)) != -1;
+  }
+  static uint64_t zero_lanes(Vec v) {
+    return uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8
+					 (v, _mm256_setzero_si256())));
+  }
+  static uint64_t changed_lanes(Vec a, Vec b) {
+    return ~uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)));
+  }
+  static uint8_t and_reduce(Vec v) {
+    return SsseLanes::and_reduce(_mm_and_si128(_mm256_castsi256_si128(v),
+					       _mm256_extracti128_si256(v, 1)));
+  }
+};
+#endif
+
+#if defined(__AVX512BW__)
+// vpshufb again looks up within each 128 bit quarter
+struct Avx512Lanes {
+  typedef __m512i Vec;
+  static constexpr Index WIDTH = 64;
+  static Vec load(const uint8_t* p) { return _mm512_loadu_si512(p); }
+  static void store(uint8_t* p, Vec v) { _mm512_storeu_si512(p, v); }
+  static Vec broadcast(uint8_t x) { return _mm512_set1_epi8(x); }
+  static Vec lookup(const uint8_t* table, Vec index) {
+    // masked for the same gcc 12 warning as and_reduce
+    return _mm512_shuffle_epi8(_mm512_maskz_broadcast_i32x4
+			       (0xFFFF, _mm_load_si128(reinterpret_cast
+					       <const __m128i*>(table))),
+			       index);
+  }
+  static Vec low_nibble(Vec v) {
+    return _mm512_and_si512(v, _mm512_set1_epi8(0x0F));
+  }
+  static Vec high_nibble(Vec v) {
+    return _mm512_and_si512(_mm512_srli_epi16(v, 4),
+			    _mm512_set1_epi8(0x0F));
+  }
+  static Vec vand(Vec a, Vec b) { return _mm512_and_si512(a, b); }
+  static Vec vor(Vec a, Vec b) { return _mm512_or_si512(a, b); }
+  static bool any_zero(Vec v) { return _mm512_testn_epi8_mask(v, v); }
+  static bool differs(Vec a, Vec b) { return _mm512_cmpneq_epi8_mask(a, b); }
+  static uint64_t zero_lanes(Vec v) { return _mm512_testn_epi8_mask(v, v); }
+  static uint64_t changed_lanes(Vec a, Vec b) {
+    return _mm512_cmpneq_epi8_mask(a, b);
+  }
+  // the masked extracts dodge a false -Wuninitialized in gcc 12's
+  // headers for the plain ones
+  static uint8_t and_reduce(Vec v) {
+    return Avx2Lanes::and_reduce(_mm256_and_si256
+				 (_mm512_maskz_extracti64x4_epi64(0xF, v, 0),
+				  _mm512_maskz_extracti64x4_epi64(0xF, v, 1)));
+  }
+};
+typedef Avx512Lanes NativeLanes;
+#elif defined(__AVX2__)
+typedef Avx2Lanes NativeLanes;
+#elif defined(__SSSE3__)
+typedef SsseLanes NativeLanes;
+#else
+typedef ScalarLanes NativeLanes;
+#endif
+
+// update_basis_states on L::WIDTH bases at once, each lane holding
+// its own seven states.  same rules in the same order as
+// propagate_basis_states.
+template <typename L>
+inline void propagate_lanes(typename L::Vec& term_i,
+			    typename L::Vec& term_j,
+			    typename L::Vec& term_k,
+			    typename L::Vec& pair_ij,
+			    typename L::Vec& pair_ik,
+			    typename L::Vec& pair_jk,
+			    typename L::Vec& basis) {
+  typedef typename L::Vec Vec;
+  const LaneTables& t = lane_tables;
+  // terms -> pairs -> basis
+  const Vec first_i = L::lookup(t.first_pairs, term_i);
+  pair_ij = L::vand(pair_ij,
+		    L::vand(first_i, L::lookup(t.second_pairs, term_j)));
+  pair_ik = L::vand(pair_ik,
+		    L::vand(first_i, L::lookup(t.second_pairs, term_k)));
+  pair_jk = L::vand(pair_jk,
+		    L::vand(L::lookup(t.first_pairs, term_j),
+			    L::lookup(t.second_pairs, term_k)));
+  basis = L::vand(basis,
+		  L::vand(L::vand(L::lookup(t.basis_i, term_i),
+				  L::vand(L::lookup(t.basis_j, term_j),
+					  L::lookup(t.basis_k, term_k))),
+			  L::vand(L::lookup(t.ij_basis, pair_ij),
+				  L::vand(L::lookup(t.ik_basis, pair_ik),
+					  L::lookup(t.jk_basis, pair_jk)))));
+  // basis -> pairs -> terms
+  const Vec low = L::low_nibble(basis);
+  const Vec high = L::high_nibble(basis);
+  pair_ij = L::vand(pair_ij, L::vor(L::lookup(t.ij_low, low),
+				    L::lookup(t.ij_high, high)));
+  pair_ik = L::vand(pair_ik, L::vor(L::lookup(t.ik_low, low),
+				    L::lookup(t.ik_high, high)));
+  pair_jk = L::vand(pair_jk, L::vor(L::lookup(t.jk_low, low),
+				    L::lookup(t.jk_high, high)));
+  term_i = L::vand(term_i, L::vor(L::lookup(t.first_terms, pair_ij),
+				  L::lookup(t.first_terms, pair_ik)));
+  term_j = L::vand(term_j, L::vor(L::lookup(t.second_terms, pair_ij),
+				  L::lookup(t.first_terms, pair_jk)));
+  term_k = L::vand(term_k, L::vor(L::lookup(t.second_terms, pair_ik),
+				  L::lookup(t.second_terms, pair_jk)));
+}
+
+}  // namespace
@@ -0,0 +1,55 @@
+// MIT License
+
+// Copyright (c) 2025 Daniel Issen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "state_store.h"
+#include "lane_kernels.h"
+
+bool narrow_states(std::vector<uint8_t>& states,
+		   const std::vector<uint8_t>& other,
+		   bool& changed) {
+  return lane_kernels().narrow_states(states.data(), other.data(),
+				      states.size(), changed);
+}
+
+template <unsigned BITS>
+bool PackedStates<BITS>::narrow(const PackedStates& other, bool& changed) {
+  // the low bit of every field
+  const uint8_t low = (BITS == 2) ? 0x55 : 0x11;
+  uint8_t lost = 0;
+  uint8_t empty = 0;
+  for (size_t b = 0; b < bytes_.size(); ++b) {
+    uint8_t merged = bytes_[b] & other.bytes_[b];
+    lost |= merged ^ bytes_[b];
+    bytes_[b] = merged;
+    // fold each field onto its low bit
+    uint8_t any = merged;
+    for (unsigned bit = 1; bit < BITS; ++bit) {
+      any |= merged >> bit;
+    }
+    empty |= ~any & low;
+  }
+  changed = changed || lost;
+  return !empty;
+}
+
+template class PackedStates<2>;
+template class PackedStates<4>;
@@ -0,0 +1,375 @@
+// MIT License
+
+// Copyright (c) 2025 Daniel Issen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// The term, pair and basis states of one formula.  a StateStore owns
+// the three levels and addresses them by term, so its users never
+// compute a pair2d or pair3d index themselves.  each level is a
+// container with size(), operator[] and, for writes, either a
+// uint8_t& or a proxy that supports &=:
+//
+//   std::vector<uint8_t>  one state per byte, what the SIMD kernels,
+//                         the row sweep and the parallel engines
+//                         other than copy-and-merge run on
+//   PackedStates<BITS>    8 / BITS states per byte.  terms need 2
+//                         bits and pairs 4, so this halves the pairs
+//                         and quarters the terms
+//   ZeroPageStates        inverted bases on zero pages (see
+//                         zero_page_states.h)
+//   FixedStates           one state per byte in a fixed size buffer,
+//                         the stack-resident store of the small
+//                         engine
+//
+// The engine kernels are templates over the three container types,
+// so a new backend is a new container plus an alias below.
+
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "constants.h"
+#include "huge_pages.h"
+#include "pairing.h"
+#include "zero_page_states.h"
+
+// 2 or 4 bit states, packed low bits first.  the fields past size()
+// in the last byte are kept all ones so they never look like a
+// contradiction.
+template <unsigned BITS>
+class PackedStates {
+  static_assert(BITS == 2 || BITS == 4, "states take 2 or 4 bits");
+  static constexpr unsigned PER_BYTE = 8 / BITS;
+  static constexpr uint8_t MASK = (1u << BITS) - 1;
+
+public:
+  // Write access to one state
+  class Ref {
+  public:
+    Ref(uint8_t* byte, unsigned shift) : byte_(byte), shift_(shift) {}
+
+    operator uint8_t() const { return (*byte_ >> shift_) & MASK; }
+
+    Ref& operator&=(uint8_t mask) {
+      *byte_ &= ~((~mask & MASK) << shift_);
+      return *this;
+    }
+
+    Ref& operator=(uint8_t state) {
+      *byte_ = (*byte_ & ~(MASK << shift_)) | ((state & MASK) << shift_);
+      return *this;
+    }
+
+  private:
+    uint8_t* byte_;
+    unsigned shift_;
+  };
+
+  PackedStates() = default;
+  // size states, all set to state
+  PackedStates(Index size, uint8_t state) { resize(size, state); }
+
+  Index size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  uint8_t operator[](Index idx) const {
+    return (bytes_[idx / PER_BYTE] >> shift(idx)) & MASK;
+  }
+  Ref operator[](Index idx) {
+    return Ref(&bytes_[idx / PER_BYTE], shift(idx));
+  }
+
+  // Grow to size states, the new ones set to state
+  void resize(Index size, uint8_t state) {
+    if (size <= size_) {
+      return;
+    }
+    Index first = size_;
+    bytes_.resize((size + PER_BYTE - 1) / PER_BYTE, 0xff);
+    size_ = size;
+    // whole bytes came in as padding, only the states need setting
+    for (Index idx = first; idx < size_; ++idx) {
+      (*this)[idx] = state;
+    }
+  }
+
+  // Make room for size states without growing again
+  void reserve(Index size) {
+    reserve_huge(bytes_, (size + PER_BYTE - 1) / PER_BYTE);
+  }
+
+  size_t memory_bytes() const { return bytes_.size(); }
+
+  // AND other into these states.  sets changed if any state lost a
+  // bit and returns false if one went to zero.
+  bool narrow(const PackedStates& other, bool& changed);
+
+private:
+  static unsigned shift(Index idx) {
+    return static_cast<unsigned>(idx % PER_BYTE) * BITS;
+  }
+
+  std::vector<uint8_t> bytes_;
+  Index size_ = 0;
+};
+
+// One state per byte in a buffer the caller owns, e.g. on its stack.
+// grows up to the capacity it was given and never allocates.
+class FixedStates {
+public:
+  FixedStates() = default;
+  FixedStates(uint8_t* data, Index capacity)
+    : data_(data), capacity_(capacity) {}
+
+  Index size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  Index capacity() const { return capacity_; }
+
+  uint8_t operator[](Index idx) const { return data_[idx]; }
+  uint8_t& operator[](Index idx) { return data_[idx]; }
+
+  uint8_t* data() { return data_; }
+  const uint8_t* data() const { return data_; }
+
+  // Grow to size states, the new ones set to state
+  void resize(Index size, uint8_t state) {
+    if (size <= size_) {
+      return;
+    }
+    reserve(size);
+    std::fill(data_ + size_, data_ + size, state);
+    size_ = size;
+  }
+
+  // throws std::length_error past the capacity
+  void reserve(Index size) const {
+    if (size > capacity_) {
+      throw std::length_error("fixed state buffer too small");
+    }
+  }
+
+private:
+  uint8_t* data_ = nullptr;
+  Index size_ = 0;
+  Index capacity_ = 0;
+};
+
+// grow a level to size states, the new ones set to state
+inline void grow_states(std::vector<uint8_t>& states, Index size,
+			uint8_t state) {
+  states.resize(size, state);
+}
+
+inline void grow_states(FixedStates& states, Index size, uint8_t state) {
+  states.resize(size, state);
+}
+
+template <unsigned BITS>
+inline void grow_states(PackedStates<BITS>& states, Index size,
+			uint8_t state) {
+  states.resize(size, state);
+}
+
+// only bases live on zero pages and they start as SET_ANY_ANY_ANY
+inline void grow_states(ZeroPageStates& states, Index size,
+			uint8_t /* state */) {
+  states.resize(size);
+}
+
+// make room for size states, so growing one term at a time never
+// holds the old and a doubled copy of a level at once.  this is also
+// where a level gets its huge pages (see huge_pages.h).
+inline void reserve_states(std::vector<uint8_t>& states, Index size) {
+  reserve_huge(states, size);
+}
+
+template <unsigned BITS>
+inline void reserve_states(PackedStates<BITS>& states, Index size) {
+  states.reserve(size);
+}
+
+// zero pages grow in place through mremap
+inline void reserve_states(ZeroPageStates& /* states */,
+			   Index /* size */) {
+}
+
+inline void reserve_states(FixedStates& states, Index size) {
+  states.reserve(size);
+}
+
+// bytes of memory one level takes
+inline size_t state_bytes(const std::vector<uint8_t>& states) {
+  return states.size();
+}
+
+template <unsigned BITS>
+inline size_t state_bytes(const PackedStates<BITS>& states) {
+  return states.memory_bytes();
+}
+
+inline size_t state_bytes(const ZeroPageStates& states) {
+  return states.resident_bytes();
+}
+
+inline size_t state_bytes(const FixedStates& states) {
+  return states.size();
+}
+
+// AND the states of other into states, the way the copy-and-merge
+// engine combines its workers.  sets changed if a state lost a bit
+// and returns false if one went to zero.
+bool narrow_states(std::vector<uint8_t>& states,
+		   const std::vector<uint8_t>& other,
+		   bool& changed);
+
+template <unsigned BITS>
+inline bool narrow_states(PackedStates<BITS>& states,
+			  const PackedStates<BITS>& other,
+			  bool& changed) {
+  return states.narrow(other, changed);
+}
+
+inline bool narrow_states(ZeroPageStates& states,
+			  const ZeroPageStates& other,
+			  bool& changed) {
+  return states.narrow(other, changed);
+}
+
+template <typename Terms, typename Pairs, typename Bases>
+struct StateStore {
+  typedef Terms TermStates;
+  typedef Pairs PairStates;
+  typedef Bases BasisStates;
+
+  TermStates terms;
+  PairStates pairs;
+  BasisStates bases;
+
+  StateStore() = default;
+  // num_terms terms with every state unconstrained
+  explicit StateStore(Index num_terms) {
+    reserve_terms(num_terms);
+    add_terms(num_terms);
+  }
+
+  Index num_terms() const { return terms.size(); }
+
+  uint8_t term(Index i) const { return terms[i]; }
+  uint8_t pair(Index i, Index j) const { return pairs[pair2d(i, j)]; }
+  uint8_t basis(Index i, Index j, Index k) const {
+    return bases[pair3d(i, j, k)];
+  }
+
+  // AND mask into one state, false if that leaves it zero
+  bool narrow_term(Index i, uint8_t mask) {
+    terms[i] &= mask;
+    return terms[i] != 0;
+  }
+  bool narrow_pair(Index i, Index j, uint8_t mask) {
+    Index idx = pair2d(i, j);
+    pairs[idx] &= mask;
+    return pairs[idx] != 0;
+  }
+  bool narrow_basis(Index i, Index j, Index k, uint8_t mask) {
+    Index idx = pair3d(i, j, k);
+    bases[idx] &= mask;
+    return bases[idx] != 0;
+  }
+
+  // Add count unconstrained terms, e.g. the auxiliary terms of
+  // clauses longer than 3 literals
+  void add_terms(Index count) {
+    Index num_terms = terms.size() + count;
+    grow_states(terms, num_terms, SET_ANY);
+    grow_states(pairs, calculate_array_size_2d(num_terms), SET_ANY_ANY);
+    grow_states(bases, calculate_array_size_3d(num_terms),
+		SET_ANY_ANY_ANY);
+  }
+
+  // Make room for num_terms terms in all three levels
+  void reserve_terms(Index num_terms) {
+    reserve_states(terms, num_terms);
+    reserve_states(pairs, calculate_array_size_2d(num_terms));
+    reserve_states(bases, calculate_array_size_3d(num_terms));
+  }
+
+  size_t memory_bytes() const {
+    return state_bytes(terms) + state_bytes(pairs) + state_bytes(bases);
+  }
+
+  // AND every state of other into ours.  sets changed if a state
+  // lost a bit and returns false on a contradiction.
+  bool narrow(const StateStore& other, bool& changed) {
+    return narrow_states(terms, other.terms, changed) &&
+      narrow_states(pairs, other.pairs, changed) &&
+      narrow_states(bases, other.bases, changed);
+  }
+};
+
+typedef StateStore<std::vector<uint8_t>, std::vector<uint8_t>,
+		   std::vector<uint8_t>> DenseStateStore;
+// pairs two to a byte
+typedef StateStore<std::vector<uint8_t>, PackedStates<4>,
+		   std::vector<uint8_t>> NibbleStateStore;
+// pairs two and terms four to a byte
+typedef StateStore<PackedStates<2>, PackedStates<4>,
+		   std::vector<uint8_t>> BitStateStore;
+// dense terms and pairs, bases on zero pages
+typedef StateStore<std::vector<uint8_t>, std::vector<uint8_t>,
+		   ZeroPageStates> ZeroPageStateStore;
+
+// dense states in a SmallStateBuffer, what the small engine solves
+// in.  copying one copies the views, not the states.
+typedef StateStore<FixedStates, FixedStates, FixedStates> SmallStateStore;
+
+// Room for the states of up to MAX_TERMS terms, small enough for the
+// stack
+template <Index MAX_TERMS>
+struct SmallStateBuffer {
+  uint8_t terms[MAX_TERMS];
+  uint8_t pairs[MAX_TERMS * (MAX_TERMS - 1) / 2];
+  uint8_t bases[MAX_TERMS * (MAX_TERMS - 1) * (MAX_TERMS - 2) / 6];
+
+  // an empty store over this buffer
+  SmallStateStore store() {
+    SmallStateStore states;
+    states.terms = FixedStates(terms, sizeof(terms));
+    states.pairs = FixedStates(pairs, sizeof(pairs));
+    states.bases = FixedStates(bases, sizeof(bases));
+    return states;
+  }
+};
+
+// Which store check_satisfiability solves in
+enum class StateBackend {
+    DENSE,
+    NIBBLE,
+    BIT
+};
+
+// Instantiate a function template once per store.  X is a macro
+// taking the store type.
+#define FOR_EACH_STATE_STORE(X) \
+  X(DenseStateStore)		\
+  X(NibbleStateStore)		\
+  X(BitStateStore)		\
+  X(ZeroPageStateStore)
@@ -23,8 +23,14 @@
 #include "test_utils.h"
 #include "file_parser.h"
 #include "cnf_solver.h"  // For check_satisfiability
+#include "basis_rows.h"
+#include "lane_kernels.h"
+#include "huge_pages.h"
 #include <iostream>
 #include <chrono>
+#include <algorithm>
+#include <random>
+#include <cmath>
 
 // Simple brute force check for satisfiability (for small instances)
 bool check_satisfiability_brute_force
@@ -43,33 +49,29 @@ bool check_satisfiability_brute_force
   num_solutions = 0;
     
   auto start = std::chrono::high_resolution_clock::now();
-    
-  for (uint64_t assignment = 0; assignment < max_assignments; assignment++) {
-    bool valid = true;
-        
-    // Check each clause
-    for (const auto& clause : cnf_clauses) {
-      bool clause_satisfied = false;
-            
-      // A clause is satisfied if at least one of its literals is true
-      for (const auto& literal : clause) {
-	int var = literal.var - 1; // Convert to 0-indexed
-	bool var_value = (assignment >> var) & 1; // Extract bit for
-						  // this variable 
-                
-	if (var_value != literal.negated) {
-	  clause_satisfied = true;
-	  break;
-	}
-      }
-            
-      if (!clause_satisfied) {
-	valid = false;
-	break;
-      }
+
+  // Check 64 assignments per word, bit b of block x is assignment
+  // x * 64 + b
+  std::vector<uint32_t> literals;
+  std::vector<Index> clause_ends;
+  for (const auto& clause : cnf_clauses) {
+    for (const auto& literal : clause) {
+      // Convert to 0-indexed
+      literals.push_back((literal.var - 1) * 2 + literal.negated);
     }
-        
-    if (valid) {
+    clause_ends.push_back(literals.size());
+  }
+  const uint64_t num_blocks = (max_assignments + 63) / 64;
+  std::vector<uint64_t> valid_blocks(num_blocks);
+  lane_kernels().evaluate_assignments(literals.data(), clause_ends.data(),
+				      clause_ends.size(), 0, num_blocks,
+				      valid_blocks.data());
+  if (max_assignments < 64) {
+    valid_blocks[0] &= (uint64_t(1) << max_assignments) - 1;
+  }
+
+  for (uint64_t assignment = 0; assignment < max_assignments; assignment++) {
+    if ((valid_blocks[assignment / 64] >> (assignment % 64)) & 1) {
       num_solutions++;
       std::cout << "Solution " << num_solutions << ": ";
       for (int var = 0; var < num_vars; var++) {
@@ -92,7 +94,7 @@ bool check_satisfiability_brute_force
 }
 
 // Test random formulas with algorithm selection
-void test_random_formulas(int num_workers,int num_tests, int num_vars, int num_clauses, int max_literals_per_clause, bool find_solution) {
+void test_random_formulas(int num_workers,int num_tests, int num_vars, int num_clauses, int max_literals_per_clause, bool find_solution, const ConsistencyOptions& options) {
   std::cout << "Testing " << num_tests << " random formulas..." << std::endl;
   std::cout << "Parameters: " 
 	    << num_vars << " variables, " 
@@ -101,6 +103,7 @@ void test_random_formulas(int num_workers,int num_tests, int num_vars, int num_c
 	    << std::endl;
     
   int correct_results = 0;
+  int tests_run = 0;
   double total_time = 0;
     
   for (int test = 1; test <= num_tests; test++) {
@@ -128,14 +131,23 @@ void test_random_formulas(int num_workers,int num_tests, int num_vars, int num_c
     std::cout << std::endl << "Checking satisfiability..." << std::endl;
     auto start = std::chrono::high_resolution_clock::now();
     bool result =
-      check_satisfiability(num_workers,cnf_formula, num_vars, find_solution);
+      check_satisfiability(num_workers,cnf_formula, num_vars, find_solution,
+			   "", options);
     auto end = std::chrono::high_resolution_clock::now();
     auto duration = 
       std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    if (engine_stop_reason() == StopReason::INTERRUPT) {
+      std::cout << "Interrupted, skipping the remaining tests" << std::endl;
+      break;
+    }
     total_time += duration.count();
+    ++tests_run;
         
     // Run brute force check for very small instances
-    if (num_vars <= 15) {
+    if (engine_stop_reason() != StopReason::NONE) {
+      // the solve timed out so there is nothing to compare
+      std::cout << "- Result unknown, not compared" << std::endl;
+    } else if (num_vars <= 15) {
       std::cout << std::endl << "Running brute force check..." << std::endl;
       int num_solutions = 0;
       bool brute_force_result = 
@@ -170,10 +182,763 @@ void test_random_formulas(int num_workers,int num_tests, int num_vars, int num_c
     
   // Print summary statistics
   std::cout << "Test Summary:\n";
-  std::cout << "- Tests run: " << num_tests << std::endl;
+  std::cout << "- Tests run: " << tests_run << std::endl;
   std::cout << "- Correct/consistent results: " 
 	    << correct_results 
-	    << " (" << (correct_results * 100.0 / num_tests) << "%)"
+	    << " (" << (correct_results * 100.0 / tests_run) << "%)"
+	    << std::endl;
+  std::cout << "- Average time: " << (total_time / tests_run) << std::endl;
+}
+
+// A set associative LRU cache model.  lets the layout benchmark count
+// misses without hardware performance counters.
+class CacheModel {
+public:
+  CacheModel(size_t size_bytes, size_t ways)
+    : ways_(ways), sets_(size_bytes / (LINE_BYTES * ways)),
+      tags_(sets_ * ways, UINT64_MAX), stamps_(sets_ * ways, 0) {}
+
+  void access(uint64_t address) {
+    uint64_t line = address / LINE_BYTES;
+    size_t set = (line % sets_) * ways_;
+    size_t victim = set;
+    ++clock_;
+    for(size_t way = set; way < set + ways_; ++way) {
+      if(tags_[way] == line) {
+	stamps_[way] = clock_;
+	return;
+      }
+      if(stamps_[way] < stamps_[victim]) {
+	victim = way;
+      }
+    }
+    ++misses_;
+    tags_[victim] = line;
+    stamps_[victim] = clock_;
+  }
+
+  uint64_t misses() const { return misses_; }
+
+  static constexpr uint64_t LINE_BYTES = 64;
+
+private:
+  size_t ways_;
+  size_t sets_;
+  std::vector<uint64_t> tags_;
+  std::vector<uint64_t> stamps_;
+  uint64_t clock_ = 0;
+  uint64_t misses_ = 0;
+};
+
+// The basis orders the layout benchmark compares.  the engine only
+// stores bases in COLEX order (pair3d); the others are modelled here
+// as index functions.  all three keep every basis with largest term k
+// in the slab starting at C(k,3) and differ inside a slab:
+//   COLEX   - pair2d order, bases sharing k but not j are far apart
+//   BLOCKED - the (i,j) triangle cut into LAYOUT_BLOCK x LAYOUT_BLOCK
+//             tiles stored one after another
+//   MORTON  - (i,j) in Z order, interleaving the bits of i and j
+enum class ModelLayout { COLEX, BLOCKED, MORTON };
+static constexpr Index LAYOUT_BLOCK = 8;
+
+static const char* model_layout_name(ModelLayout layout) {
+  switch(layout) {
+  case ModelLayout::BLOCKED: return "blocked";
+  case ModelLayout::MORTON: return "morton";
+  default: return "colex";
+  }
+}
+
+static Index blocked_slab_offset(Index i, Index j, Index k) {
+  Index row_start = (j / LAYOUT_BLOCK) * LAYOUT_BLOCK;
+  Index col_start = (i / LAYOUT_BLOCK) * LAYOUT_BLOCK;
+  Index rows = std::min(LAYOUT_BLOCK, k - row_start);
+  Index offset = pair2d(0, row_start) + col_start * rows;
+  if(col_start < row_start) {
+    return offset + (j - row_start) * LAYOUT_BLOCK + (i - col_start);
+  }
+  return offset + pair2d(i - row_start, j - row_start);
+}
+
+static uint64_t morton_code(uint64_t i, uint64_t j) {
+  uint64_t code = 0;
+  for(int bit = 0; bit < 32; ++bit) {
+    code |= ((i >> bit) & 1) << (2 * bit);
+    code |= ((j >> bit) & 1) << (2 * bit + 1);
+  }
+  return code;
+}
+
+// Rank of (i,j) among the pairs of slab k in Z order, for every slab
+// of a num_terms term problem
+static std::vector<std::vector<Index>> morton_slab_ranks(Index num_terms) {
+  std::vector<std::vector<Index>> ranks(num_terms);
+  for(Index k = 2; k < num_terms; ++k) {
+    std::vector<std::pair<uint64_t, Index>> codes;
+    for(Index j = 1; j < k; ++j) {
+      for(Index i = 0; i < j; ++i) {
+	codes.emplace_back(morton_code(i, j), j * k + i);
+      }
+    }
+    std::sort(codes.begin(), codes.end());
+    ranks[k].assign(k * k, 0);
+    for(size_t rank = 0; rank < codes.size(); ++rank) {
+      ranks[k][codes[rank].second] = rank;
+    }
+  }
+  return ranks;
+}
+
+void benchmark_basis_layouts(Index num_vars, Index num_pairs) {
+  const Index num_bases = calculate_array_size_3d(num_vars);
+  // start half way through the basis pairs so basis2 is a large basis
+  // and basis1 sweeps everything below it
+  const Index start = pair2d(0, num_bases / 2);
+  const Index end =
+    std::min(start + num_pairs, calculate_array_size_2d(num_bases));
+  const std::vector<std::vector<Index>> morton_ranks =
+    morton_slab_ranks(num_vars);
+
+  std::cout << "Basis layout benchmark: " << num_vars << " variables, "
+	    << (end - start) << " basis pairs" << std::endl;
+  for(ModelLayout layout :
+	{ModelLayout::COLEX, ModelLayout::BLOCKED, ModelLayout::MORTON}) {
+    auto basis_index = [&](Index i, Index j, Index k) -> Index {
+      switch(layout) {
+      case ModelLayout::BLOCKED:
+	return calculate_array_size_3d(k) + blocked_slab_offset(i, j, k);
+      case ModelLayout::MORTON:
+	return calculate_array_size_3d(k) + morton_ranks[k][j * k + i];
+      default:
+	return pair3d(i, j, k);
+      }
+    };
+    CacheModel l1(32 * 1024, 8);
+    CacheModel l2(1024 * 1024, 16);
+    uint64_t accesses = 0;
+    uint64_t lines = 0;
+    uint64_t pages = 0;
+    for(BasisPairIterator it(start); it.basis_pair() < end; it.next()) {
+      const BasisPair& bp = it.current();
+      Index terms[6] = {bp.i1, bp.j1, bp.k1, bp.i2, bp.j2, bp.k2};
+      std::sort(terms, terms + 6);
+      size_t term_count = std::unique(terms, terms + 6) - terms;
+      // the two bases and their intermediaries
+      uint64_t call_lines[20];
+      uint64_t call_pages[20];
+      size_t count = 0;
+      for(size_t c = 2; c < term_count; ++c) {
+	for(size_t b = 1; b < c; ++b) {
+	  for(size_t a = 0; a < b; ++a) {
+	    Index basis_idx = basis_index(terms[a], terms[b], terms[c]);
+	    l1.access(basis_idx);
+	    l2.access(basis_idx);
+	    call_lines[count] = basis_idx / CacheModel::LINE_BYTES;
+	    call_pages[count] = basis_idx / 4096;
+	    ++count;
+	  }
+	}
+      }
+      accesses += count;
+      std::sort(call_lines, call_lines + count);
+      std::sort(call_pages, call_pages + count);
+      lines += std::unique(call_lines, call_lines + count) - call_lines;
+      pages += std::unique(call_pages, call_pages + count) - call_pages;
+    }
+
+    double calls = static_cast<double>(end - start);
+    std::cout << "- " << model_layout_name(layout) << ": "
+	      << l1.misses() << " L1 misses, "
+	      << l2.misses() << " L2 misses of " << accesses
+	      << " basis reads, "
+	      << (lines / calls) << " lines and "
+	      << (pages / calls) << " pages per call" << std::endl;
+  }
+
+  // time the real kernel, which runs on the colex layout, on the
+  // same window
+  std::vector<uint8_t> term_states(num_vars, SET_ANY);
+  std::vector<uint8_t> pair_states(calculate_array_size_2d(num_vars),
+				   SET_ANY_ANY);
+  std::vector<uint8_t> basis_states(num_bases, SET_ANY_ANY_ANY);
+  auto kernel_start = std::chrono::high_resolution_clock::now();
+  for(BasisPairIterator it(start); it.basis_pair() < end; it.next()) {
+    ensure_basis_consistency(it.current(),
+			     term_states, pair_states, basis_states);
+  }
+  auto kernel_end = std::chrono::high_resolution_clock::now();
+  auto duration = std::chrono::duration_cast<std::chrono::milliseconds>
+    (kernel_end - kernel_start);
+  std::cout << "- colex kernel: " << duration.count() << " ms"
+	    << std::endl;
+}
+
+bool check_basis_kernels(Index num_vars, Index num_trials) {
+  std::mt19937_64 rng(12345);
+  const Index num_bases = calculate_array_size_3d(num_vars);
+  const Index num_basis_pairs = calculate_array_size_2d(num_bases);
+  BasisKernel saved_kernel = basis_kernel();
+  Index mismatches = 0;
+
+  std::cout << "Checking basis kernels on " << num_trials
+	    << " random basis pairs of " << num_vars << " variables..."
+	    << std::endl;
+  for(Index trial = 0; trial < num_trials; ++trial) {
+    // mostly full states with some bits knocked out so that all the
+    // paths of the kernel get exercised, including contradictions
+    std::vector<uint8_t> term_states(num_vars);
+    std::vector<uint8_t> pair_states(calculate_array_size_2d(num_vars));
+    std::vector<uint8_t> basis_states(num_bases);
+    for(auto& state : term_states) {
+      state = (rng() % 8) ? SET_ANY : (1 + rng() % 2);
+    }
+    for(auto& state : pair_states) {
+      state = (rng() % 4) ? SET_ANY_ANY : (1 + rng() % 15);
+    }
+    for(auto& state : basis_states) {
+      state = (rng() % 3) ? SET_ANY_ANY_ANY : (rng() & rng() & 255);
+    }
+    BasisPairIterator it(rng() % num_basis_pairs);
+
+    std::vector<uint8_t> scalar_terms = term_states;
+    std::vector<uint8_t> scalar_pairs = pair_states;
+    std::vector<uint8_t> scalar_bases = basis_states;
+    set_basis_kernel(BasisKernel::SCALAR);
+    UpdateResult scalar_result =
+      ensure_basis_consistency(it.current(),
+			       scalar_terms, scalar_pairs, scalar_bases);
+    set_basis_kernel(BasisKernel::BITSLICED);
+    UpdateResult bitsliced_result =
+      ensure_basis_consistency(it.current(),
+			       term_states, pair_states, basis_states);
+
+    if(scalar_result.changed != bitsliced_result.changed ||
+       scalar_result.has_zero != bitsliced_result.has_zero ||
+       scalar_terms != term_states ||
+       scalar_pairs != pair_states ||
+       scalar_bases != basis_states) {
+      if(mismatches < 10) {
+	std::cout << "- Mismatch at basis pair " << it.basis_pair()
+		  << std::endl;
+      }
+      ++mismatches;
+    }
+  }
+  set_basis_kernel(saved_kernel);
+  std::cout << "- Mismatches: " << mismatches << std::endl;
+  return mismatches == 0;
+}
+
+// update_basis_states over every basis from starting_basis on until
+// nothing changes, one basis at a time.  the reference for
+// sweep_basis_rows.
+static bool sweep_bases_one_by_one(std::vector<uint8_t>& term_states,
+				   std::vector<uint8_t>& pair_states,
+				   std::vector<uint8_t>& basis_states,
+				   Index starting_basis) {
+  bool changed;
+  do {
+    changed = false;
+    Index i, j, k;
+    std::tie(i, j, k) = unpair3d(starting_basis);
+    Index ij_idx = pair2d(i, j);
+    Index ik_idx = pair2d(i, k);
+    Index jk_idx = pair2d(j, k);
+    for(Index basis_idx = starting_basis;
+	basis_idx < basis_states.size();
+	++basis_idx,
+	  BasisPairIterator::advance_basis(i, j, k,
+					   ij_idx, ik_idx, jk_idx)) {
+      UpdateResult result = update_basis_states(i, j, k,
+						ij_idx, ik_idx, jk_idx,
+						basis_idx,
+						term_states,
+						pair_states,
+						basis_states);
+      if(result.has_zero) {
+	return false;
+      }
+      changed = changed || result.changed;
+    }
+  } while(changed);
+  return true;
+}
+
+bool check_basis_rows(Index num_vars, Index num_trials) {
+  std::mt19937_64 rng(12345);
+  const Index num_bases = calculate_array_size_3d(num_vars);
+  Index mismatches = 0;
+  Index contradictions = 0;
+  double row_ms = 0;
+  double basis_ms = 0;
+
+  std::cout << "Checking row sweeps on " << num_trials
+	    << " random states of " << num_vars << " variables..."
+	    << std::endl;
+  for(Index trial = 0; trial < num_trials; ++trial) {
+    // a few narrowed states in a sea of full ones, so most trials
+    // propagate for a while before settling or contradicting
+    std::vector<uint8_t> term_states(num_vars, SET_ANY);
+    std::vector<uint8_t> pair_states(calculate_array_size_2d(num_vars),
+				     SET_ANY_ANY);
+    std::vector<uint8_t> basis_states(num_bases, SET_ANY_ANY_ANY);
+    Index num_narrowed = rng() % 12;
+    for(Index narrowed = 0; narrowed < num_narrowed; ++narrowed) {
+      basis_states[rng() % num_bases] &= ~(rng() & rng() & 255);
+      pair_states[rng() % pair_states.size()] &= 1 + rng() % 15;
+    }
+    if(rng() % 2) {
+      term_states[rng() % num_vars] = 1 + rng() % 2;
+    }
+    Index starting_basis = (rng() % 4) ? 0 : rng() % num_bases;
+
+    std::vector<uint8_t> basis_terms = term_states;
+    std::vector<uint8_t> basis_pairs = pair_states;
+    std::vector<uint8_t> basis_bases = basis_states;
+    auto start = std::chrono::high_resolution_clock::now();
+    bool consistent = sweep_bases_one_by_one(basis_terms, basis_pairs,
+					     basis_bases, starting_basis);
+    auto middle = std::chrono::high_resolution_clock::now();
+    bool has_contradiction = false;
+    sweep_basis_rows(term_states, pair_states, basis_states,
+		     has_contradiction, starting_basis);
+    auto end = std::chrono::high_resolution_clock::now();
+    basis_ms +=
+      std::chrono::duration<double, std::milli>(middle - start).count();
+    row_ms +=
+      std::chrono::duration<double, std::milli>(end - middle).count();
+
+    // the two stop at different places on a contradiction, so only
+    // compare the states of a fixpoint
+    bool agree = consistent ?
+      (!has_contradiction &&
+       basis_terms == term_states &&
+       basis_pairs == pair_states &&
+       basis_bases == basis_states) :
+      has_contradiction;
+    contradictions += !consistent;
+    if(!agree) {
+      if(mismatches < 10) {
+	std::cout << "- Mismatch in trial " << trial << std::endl;
+      }
+      ++mismatches;
+    }
+  }
+  std::cout << "- Contradictions: " << contradictions << std::endl;
+  std::cout << "- Mismatches: " << mismatches << std::endl;
+  std::cout << "- Per basis sweep: " << basis_ms << " ms" << std::endl;
+  std::cout << "- Row sweep: " << row_ms << " ms" << std::endl;
+  return mismatches == 0;
+}
+
+// Round trip one basis pair index through unpair2d, counting a
+// mismatch if it does not land on (i,j)
+static bool pair2d_round_trips(Index i, Index j) {
+  Index index = pair2d(i, j);
+  Index i2, j2;
+  std::tie(i2, j2) = unpair2d(index);
+  return i2 == i && j2 == j && index == (j * (j - 1)) / 2 + i;
+}
+
+bool check_pairing(Index num_terms) {
+  Index mismatches = 0;
+  auto report = [&mismatches](const char* what, Index index) {
+    if(mismatches < 10) {
+      std::cout << "- Mismatch in " << what << " at " << index << std::endl;
+    }
+    ++mismatches;
+  };
+
+  std::cout << "Checking pairing functions on " << num_terms
+	    << " terms..." << std::endl;
+  // every pair and basis index in order, so the inverses are checked
+  // against the walk rather than against themselves
+  Index index = 0;
+  for(Index j = 1; j < num_terms; ++j) {
+    for(Index i = 0; i < j; ++i, ++index) {
+      Index i2, j2;
+      std::tie(i2, j2) = unpair2d(index);
+      if(pair2d(i, j) != index || i2 != i || j2 != j) {
+	report("pair2d", index);
+      }
+    }
+  }
+  Index i = 0, j = 1, k = 2;
+  Index ij_idx = 0, ik_idx = 1, jk_idx = 2;
+  const Index num_bases = calculate_array_size_3d(num_terms);
+  for(Index basis_idx = 0; basis_idx < num_bases;
+      ++basis_idx,
+	BasisPairIterator::advance_basis(i, j, k, ij_idx, ik_idx, jk_idx)) {
+    Index i2, j2, k2;
+    std::tie(i2, j2, k2) = unpair3d(basis_idx);
+    if(pair3d(i, j, k) != basis_idx || i2 != i || j2 != j || k2 != k ||
+       ij_idx != pair2d(i, j) || ik_idx != pair2d(i, k) ||
+       jk_idx != pair2d(j, k)) {
+      report("pair3d", basis_idx);
+    }
+  }
+
+  // the ends of every slab and the rows of the basis pair index up
+  // to the largest problem this build takes, where the indices no
+  // longer fit a double
+  Index max_terms = 3;
+  while(index_range_fits(max_terms + 1)) {
+    ++max_terms;
+  }
+  for(Index k = 2; k < max_terms; ++k) {
+    Index slab = calculate_array_size_3d(k);
+    Index i2, j2, k2;
+    std::tie(i2, j2, k2) = unpair3d(slab);
+    if(pair3d(0, 1, k) != slab || i2 != 0 || j2 != 1 || k2 != k) {
+      report("slab start", slab);
+    }
+    std::tie(i2, j2, k2) = unpair3d(slab + calculate_array_size_2d(k) - 1);
+    if(i2 != k - 2 || j2 != k - 1 || k2 != k) {
+      report("slab end", slab);
+    }
+  }
+  const Index max_bases = calculate_array_size_3d(max_terms);
+  const Index window = 1 << 20;
+  for(Index j = 1; j < max_bases; ++j) {
+    if(j == window && max_bases > 2 * window) {
+      j = max_bases - window;
+    }
+    if(!pair2d_round_trips(0, j) || !pair2d_round_trips(j - 1, j)) {
+      report("basis pair row", j);
+    }
+  }
+  std::cout << "- Largest problem: " << max_terms << " terms, "
+	    << calculate_array_size_2d(max_bases) << " basis pairs"
+	    << std::endl;
+  std::cout << "- Mismatches: " << mismatches << std::endl;
+  return mismatches == 0;
+}
+
+// The floating point inverses: a sqrt or cbrt estimate walked onto
+// the answer.  the baseline for benchmark_pairing.
+static std::tuple<Index, Index> float_unpair2d(Index index) {
+  Index j = static_cast<Index>((1.0 + std::sqrt(1.0 + 8.0 * index)) / 2.0);
+  while ((j * (j - 1)) / 2 > index) j--;
+  while ((j + 1) * j / 2 <= index) j++;
+  return std::make_tuple(index - (j * (j - 1)) / 2, j);
+}
+
+static std::tuple<Index, Index, Index> float_unpair3d(Index index) {
+  Index k = static_cast<Index>(std::cbrt(6.0 * index));
+  while ((k * (k - 1) * (k - 2)) / 6 > index) k--;
+  while ((k + 1) * k * (k - 1) / 6 <= index) k++;
+  Index i, j;
+  std::tie(i, j) = float_unpair2d(index - (k * (k - 1) * (k - 2)) / 6);
+  return std::make_tuple(i, j, k);
+}
+
+void benchmark_pairing(Index num_terms) {
+  const size_t count = 1 << 22;
+  const Index num_bases = calculate_array_size_3d(num_terms);
+  std::mt19937_64 rng(12345);
+  std::vector<Index> terms(3 * count);
+  std::vector<Index> basis_idxs(count);
+  std::vector<Index> basis_pairs(count);
+  for(size_t n = 0; n < count; ++n) {
+    Index t[3];
+    do {
+      t[0] = rng() % num_terms;
+      t[1] = rng() % num_terms;
+      t[2] = rng() % num_terms;
+      std::sort(t, t + 3);
+    } while(t[0] == t[1] || t[1] == t[2]);
+    std::copy(t, t + 3, &terms[3 * n]);
+    basis_idxs[n] = rng() % num_bases;
+    basis_pairs[n] = rng() % calculate_array_size_2d(num_bases);
+  }
+
+  std::cout << "Pairing benchmark: " << num_terms << " terms, "
+	    << count << " calls each" << std::endl;
+  // the sum keeps the calls from being optimized away
+  auto time = [count](const char* name, auto&& call) {
+    Index sum = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for(size_t n = 0; n < count; ++n) {
+      sum += call(n);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    std::cout << "- " << name << ": " << (ns / count)
+	      << " ns per call (checksum " << (sum & 0xFFFF) << ")"
+	      << std::endl;
+  };
+  time("pair2d", [&](size_t n) {
+    return pair2d(terms[3 * n], terms[3 * n + 2]);
+  });
+  time("pair2d table", [&](size_t n) {
+    return triangular(terms[3 * n + 2]) + terms[3 * n];
+  });
+  time("pair3d", [&](size_t n) {
+    return pair3d(terms[3 * n], terms[3 * n + 1], terms[3 * n + 2]);
+  });
+  time("pair3d arithmetic", [&](size_t n) {
+    Index i = terms[3 * n], j = terms[3 * n + 1], k = terms[3 * n + 2];
+    return (k * (k - 1) * (k - 2)) / 6 + (j * (j - 1)) / 2 + i;
+  });
+  time("unpair2d", [&](size_t n) {
+    return std::get<0>(unpair2d(basis_pairs[n]));
+  });
+  time("unpair2d floating point", [&](size_t n) {
+    return std::get<0>(float_unpair2d(basis_pairs[n]));
+  });
+  time("unpair3d", [&](size_t n) {
+    return std::get<0>(unpair3d(basis_idxs[n]));
+  });
+  time("unpair3d floating point", [&](size_t n) {
+    return std::get<0>(float_unpair3d(basis_idxs[n]));
+  });
+}
+
+// Check formulas with check_satisfiability_batch and one at a time
+// with the sequential engine, print how they compare and return the
+// number of answers that differ
+static int compare_batch_formulas
+(const std::vector<std::vector<std::vector<Literal>>>& formulas,
+ int num_vars) {
+  auto start = std::chrono::high_resolution_clock::now();
+  std::vector<bool> batch_results =
+    check_satisfiability_batch(formulas, num_vars);
+  auto middle = std::chrono::high_resolution_clock::now();
+
+  // check_satisfiability without the solution finding and the output
+  std::vector<bool> single_results;
+  for (const auto& formula : formulas) {
+    std::vector<uint8_t> term_states(num_vars, SET_ANY);
+    std::vector<uint8_t> pair_states(calculate_array_size_2d(num_vars),
+				     SET_ANY_ANY);
+    std::vector<uint8_t> basis_states(calculate_array_size_3d(num_vars),
+				      SET_ANY_ANY_ANY);
+    int working_num_vars = num_vars;
+    bool has_contradiction =
+      !apply_constraints(formula, working_num_vars,
+			 term_states, pair_states, basis_states) ||
+      !ensure_cross_level_consistency(term_states, pair_states,
+				      basis_states);
+    if (!has_contradiction) {
+      ensure_global_consistency(term_states, pair_states, basis_states,
+				has_contradiction, 0,
+				calculate_array_size_2d(basis_states.size()));
+    }
+    single_results.push_back(!has_contradiction);
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+
+  int mismatches = 0;
+  int satisfiable = 0;
+  for (size_t test = 0; test < formulas.size(); test++) {
+    if (batch_results[test] != single_results[test]) {
+      if (mismatches < 10) {
+	std::cout << "- Mismatch on formula " << test << std::endl;
+      }
+      ++mismatches;
+    }
+    satisfiable += batch_results[test];
+  }
+  std::cout << "- Satisfiable: " << satisfiable << " of " << formulas.size()
+	    << std::endl;
+  std::cout << "- Mismatches: " << mismatches << std::endl;
+  std::cout << "- Batched: "
+	    << std::chrono::duration<double, std::milli>(middle - start).count()
+	    << " ms" << std::endl;
+  std::cout << "- One at a time: "
+	    << std::chrono::duration<double, std::milli>(end - middle).count()
+	    << " ms" << std::endl;
+  return mismatches;
+}
+
+bool test_batch_formulas(int num_tests,
+			 int num_vars,
+			 int num_clauses,
+			 int max_literals_per_clause) {
+  std::cout << "Testing " << num_tests << " random formulas, "
+	    << batch_lanes() << " per batch..." << std::endl;
+  std::vector<std::vector<std::vector<Literal>>> formulas;
+  for (int test = 0; test < num_tests; test++) {
+    formulas.push_back(generate_random_cnf(num_vars, num_clauses,
+					   max_literals_per_clause));
+  }
+  int mismatches = compare_batch_formulas(formulas, num_vars);
+
+  // clauses of more than 3 literals add a different number of terms
+  // to each formula of a batch.  kept small, every lane grows to the
+  // widest formula.
+  const int long_vars = 6;
+  const int long_clauses = 3;
+  const int long_literals = 5;
+  std::cout << "Testing " << batch_lanes() << " random formulas with up to "
+	    << long_literals << " literals per clause..." << std::endl;
+  formulas.clear();
+  for (Index test = 0; test < batch_lanes(); test++) {
+    formulas.push_back(generate_random_cnf(long_vars, long_clauses,
+					   long_literals));
+  }
+  mismatches += compare_batch_formulas(formulas, long_vars);
+  return mismatches == 0;
+}
+
+// A few narrowed states in a sea of full ones
+static DenseStateStore random_states(Index num_vars, std::mt19937_64& rng) {
+  DenseStateStore states(num_vars);
+  Index num_narrowed = rng() % 12;
+  for(Index narrowed = 0; narrowed < num_narrowed; ++narrowed) {
+    states.bases[rng() % states.bases.size()] &= ~(rng() & rng() & 255);
+    states.pairs[rng() % states.pairs.size()] &= 1 + rng() % 15;
+  }
+  if(rng() % 2) {
+    states.terms[rng() % num_vars] = 1 + rng() % 2;
+  }
+  return states;
+}
+
+template <typename Store>
+static Store copy_states(const DenseStateStore& dense) {
+  Store states(dense.num_terms());
+  for(Index x = 0; x < dense.terms.size(); ++x) {
+    states.terms[x] &= dense.terms[x];
+  }
+  for(Index x = 0; x < dense.pairs.size(); ++x) {
+    states.pairs[x] &= dense.pairs[x];
+  }
+  for(Index x = 0; x < dense.bases.size(); ++x) {
+    states.bases[x] &= dense.bases[x];
+  }
+  return states;
+}
+
+template <typename Store>
+static bool same_states(const DenseStateStore& dense, const Store& states) {
+  for(Index x = 0; x < dense.terms.size(); ++x) {
+    if(dense.terms[x] != states.terms[x]) {
+      return false;
+    }
+  }
+  for(Index x = 0; x < dense.pairs.size(); ++x) {
+    if(dense.pairs[x] != states.pairs[x]) {
+      return false;
+    }
+  }
+  for(Index x = 0; x < dense.bases.size(); ++x) {
+    if(dense.bases[x] != states.bases[x]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Count the trials in which Store disagrees with the dense store
+template <typename Store>
+static Index check_state_store(const char* name,
+			       Index num_vars,
+			       Index num_trials) {
+  std::mt19937_64 rng(12345);
+  const Index num_basis_pairs =
+    calculate_array_size_2d(calculate_array_size_3d(num_vars));
+  Index mismatches = 0;
+  for(Index trial = 0; trial < num_trials; ++trial) {
+    // the engine to its fixpoint.  a contradiction may stop the two at
+    // different places, so only compare the states of a fixpoint.
+    DenseStateStore dense = random_states(num_vars, rng);
+    Store states = copy_states<Store>(dense);
+    bool dense_contradiction = false;
+    bool has_contradiction = false;
+    ensure_global_consistency(dense, dense_contradiction,
+			      0, num_basis_pairs);
+    ensure_global_consistency(states, has_contradiction,
+			      0, num_basis_pairs);
+    bool agree = (dense_contradiction == has_contradiction) &&
+      (dense_contradiction || same_states(dense, states));
+
+    // merging two workers' copies
+    DenseStateStore dense_a = random_states(num_vars, rng);
+    DenseStateStore dense_b = random_states(num_vars, rng);
+    Store a = copy_states<Store>(dense_a);
+    Store b = copy_states<Store>(dense_b);
+    bool dense_changed = false;
+    bool changed = false;
+    bool dense_consistent = dense_a.narrow(dense_b, dense_changed);
+    bool consistent = a.narrow(b, changed);
+    agree = agree && dense_consistent == consistent &&
+      (!dense_consistent ||
+       (dense_changed == changed && same_states(dense_a, a)));
+    if(!agree) {
+      if(mismatches < 10) {
+	std::cout << "- " << name << " mismatch in trial " << trial
+		  << std::endl;
+      }
+      ++mismatches;
+    }
+  }
+  std::cout << "- " << name << ": " << mismatches << " mismatches, "
+	    << Store(num_vars).memory_bytes() << " bytes" << std::endl;
+  return mismatches;
+}
+
+bool check_state_stores(Index num_vars, Index num_trials) {
+  std::cout << "Checking state stores on " << num_trials
+	    << " random states of " << num_vars << " variables..."
 	    << std::endl;
-  std::cout << "- Average time: " << (total_time / num_tests) << std::endl;
+  std::cout << "- dense: " << DenseStateStore(num_vars).memory_bytes()
+	    << " bytes" << std::endl;
+  Index mismatches =
+    check_state_store<NibbleStateStore>("nibble", num_vars, num_trials) +
+    check_state_store<BitStateStore>("bit", num_vars, num_trials) +
+    check_state_store<ZeroPageStateStore>("zero page", num_vars,
+					  num_trials);
+  return mismatches == 0;
+}
+
+// time ensure_basis_consistency on num_pairs random basis pairs, so
+// the bases and intermediaries read land all over basis_states.  the
+// pairs are drawn up front to keep unpairing out of the timing.
+static double time_random_basis_pairs(DenseStateStore& states,
+				      Index num_pairs) {
+  const Index num_bases = states.bases.size();
+  std::mt19937_64 rng(54321);
+  std::vector<BasisPair> pairs;
+  pairs.reserve(num_pairs);
+  for(Index p = 0; p < num_pairs; ++p) {
+    Index basis2 = 1 + rng() % (num_bases - 1);
+    Index basis1 = rng() % basis2;
+    pairs.push_back(BasisPairIterator(pair2d(basis1, basis2)).current());
+  }
+  auto start = std::chrono::high_resolution_clock::now();
+  for(const BasisPair& bp : pairs) {
+    ensure_basis_consistency(bp, states.terms, states.pairs, states.bases);
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void benchmark_huge_pages(Index max_vars) {
+  bool saved = huge_pages_enabled();
+  std::cout << "Huge page benchmark, transparent huge pages: "
+	    << transparent_huge_page_mode() << std::endl;
+  for(Index num_vars : {max_vars / 4, max_vars / 2, max_vars}) {
+    if(num_vars < 3) {
+      continue;
+    }
+    for(bool huge : {false, true}) {
+      set_huge_pages(huge);
+      DenseStateStore states(num_vars);
+      // the same sprinkling of constrained bases either way, so the
+      // kernel does real work
+      std::mt19937_64 rng(12345);
+      for(Index b = 0; b < states.bases.size(); b += 1 + rng() % 64) {
+	states.bases[b] &= ~(1u << (rng() % 8));
+      }
+      double ms = time_random_basis_pairs(states, 1000000);
+      std::cout << "- " << num_vars << " variables, "
+		<< (huge ? "huge" : "4 KiB") << " pages: "
+		<< (huge_page_bytes(states.bases.data(),
+				    states.bases.size()) >> 10)
+		<< " of " << (states.bases.size() >> 10)
+		<< " KiB on huge pages, sweep " << ms << " ms" << std::endl;
+    }
+  }
+  set_huge_pages(saved);
 }
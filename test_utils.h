@@ -24,6 +24,7 @@
 
 #include <vector>
 #include "file_parser.h"
+#include "basis_consistency.h"
 
 // Simple brute force check for satisfiability (for small instances)
 bool check_satisfiability_brute_force
@@ -37,4 +38,53 @@ void test_random_formulas(int num_workers,
 			  int num_vars,
 			  int num_clauses,
 			  int max_literals_per_clause,
-			  bool find_solution = false);
+			  bool find_solution = false,
+			  const ConsistencyOptions& options =
+			  ConsistencyOptions());
+
+// Check num_tests random formulas with the instance-parallel engine
+// and one at a time with the sequential engine, compare the answers
+// and time both.  returns true if every answer agrees.
+bool test_batch_formulas(int num_tests,
+			 int num_vars,
+			 int num_clauses,
+			 int max_literals_per_clause);
+
+// Compare the colex basis layout with modelled blocked and Morton
+// orders on a window of num_pairs basis pairs of an num_vars variable
+// problem: simulated cache misses of the basis states one
+// ensure_basis_consistency call touches, and the time the kernel takes
+// on that window in the colex layout
+void benchmark_basis_layouts(Index num_vars, Index num_pairs);
+
+// Run ensure_basis_consistency with the scalar and the bitsliced
+// kernel on num_trials random states and basis pairs and compare
+// every state they leave behind.  returns true if they always agree.
+bool check_basis_kernels(Index num_vars, Index num_trials);
+
+// Check pair2d, pair3d and their inverses against each other on
+// every index of num_terms terms, then at the
+// row and slab boundaries up to the largest problem this build's
+// Index can address.  returns true if every index round trips.
+bool check_pairing(Index num_terms);
+
+// Time the pairing functions and their inverses against the table,
+// plain arithmetic and floating point versions on random indices of
+// num_terms terms
+void benchmark_pairing(Index num_terms);
+
+// Run sweep_basis_rows and a plain per-basis update_basis_states
+// loop to their fixpoint on num_trials random states and compare
+// them, then time both.  returns true if they always agree.
+bool check_basis_rows(Index num_vars, Index num_trials);
+
+// Run the engine and the copy-and-merge narrowing on num_trials
+// random states in every StateStore and compare them with the dense
+// store, then print what one copy of each store takes for num_vars
+// variables.  returns true if they always agree.
+bool check_state_stores(Index num_vars, Index num_trials);
+
+// Time ensure_basis_consistency on random basis pairs of max_vars /
+// 4, max_vars / 2 and max_vars variables, with the states on 4 KiB
+// and on huge pages (see huge_pages.h)
+void benchmark_huge_pages(Index max_vars);
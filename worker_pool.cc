@@ -0,0 +1,126 @@
+// MIT License
+
+// Copyright (c) 2025 Daniel Issen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "worker_pool.h"
+#include <memory>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+Barrier::Barrier(size_t count)
+  : count_(count), waiting_(0), generation_(0) {}
+
+void Barrier::arrive_and_wait() {
+  std::unique_lock<std::mutex> guard(lock_);
+  size_t generation = generation_;
+  if (++waiting_ == count_) {
+    // last one in releases everybody and resets for the next round
+    waiting_ = 0;
+    ++generation_;
+    all_arrived_.notify_all();
+    return;
+  }
+  all_arrived_.wait(guard, [&] { return generation != generation_; });
+}
+
+// Pin the calling thread to the worker-th cpu in our affinity mask.
+// best effort, a failure just leaves the thread unpinned.
+static void pin_to_core(int worker) {
+#ifdef __linux__
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+    return;
+  }
+  int num_allowed = CPU_COUNT(&allowed);
+  if (num_allowed == 0) {
+    return;
+  }
+  int target = worker % num_allowed;
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (!CPU_ISSET(cpu, &allowed)) continue;
+    if (target-- == 0) {
+      cpu_set_t pinned;
+      CPU_ZERO(&pinned);
+      CPU_SET(cpu, &pinned);
+      pthread_setaffinity_np(pthread_self(), sizeof(pinned), &pinned);
+      return;
+    }
+  }
+#else
+  (void)worker;
+#endif
+}
+
+WorkerPool::WorkerPool(int num_workers, bool pin_threads)
+  : start_barrier_(num_workers + 1),
+    end_barrier_(num_workers + 1),
+    job_(nullptr),
+    stopping_(false) {
+  // the calling thread takes part in both barriers so it can hand out
+  // a job and then wait for it
+  for (int worker = 0; worker < num_workers; ++worker) {
+    threads_.emplace_back([this, worker, pin_threads] {
+      if (pin_threads) {
+	pin_to_core(worker);
+      }
+      worker_loop(worker);
+    });
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  stopping_ = true;
+  start_barrier_.arrive_and_wait();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void WorkerPool::worker_loop(int worker) {
+  while (true) {
+    start_barrier_.arrive_and_wait();
+    if (stopping_) {
+      return;
+    }
+    (*job_)(worker);
+    end_barrier_.arrive_and_wait();
+  }
+}
+
+void WorkerPool::run(const std::function<void(int)>& job) {
+  // the barriers order the writes to job_ before the workers read it
+  job_ = &job;
+  start_barrier_.arrive_and_wait();
+  end_barrier_.arrive_and_wait();
+  job_ = nullptr;
+}
+
+WorkerPool& shared_worker_pool(int num_workers) {
+  static std::unique_ptr<WorkerPool> pool;
+  if (!pool || pool->size() != num_workers) {
+    pool.reset();
+    pool.reset(new WorkerPool(num_workers));
+  }
+  return *pool;
+}
@@ -0,0 +1,81 @@
+// MIT License
+
+// Copyright (c) 2025 Daniel Issen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// persistent pool of worker threads for the parallel consistency
+// engines.  the threads are created once and reused for every
+// iteration and every solution finding round instead of spawning
+// fresh threads each time.
+
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Reusable barrier for a fixed number of threads (std::barrier is
+// C++20)
+class Barrier {
+public:
+  explicit Barrier(size_t count);
+
+  // Block until count threads have arrived
+  void arrive_and_wait();
+
+private:
+  std::mutex lock_;
+  std::condition_variable all_arrived_;
+  size_t count_;
+  size_t waiting_;
+  size_t generation_;
+};
+
+class WorkerPool {
+public:
+  // Start num_workers threads, pinning worker w to the w-th core we
+  // are allowed to run on when pin_threads is set
+  WorkerPool(int num_workers, bool pin_threads = true);
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  int size() const { return static_cast<int>(threads_.size()); }
+
+  // Run job(worker) on every worker and wait for all of them to
+  // finish
+  void run(const std::function<void(int)>& job);
+
+private:
+  void worker_loop(int worker);
+
+  std::vector<std::thread> threads_;
+  Barrier start_barrier_;
+  Barrier end_barrier_;
+  const std::function<void(int)>* job_;
+  bool stopping_;
+};
+
+// Process wide pool with num_workers threads.  the pool is created on
+// first use and only rebuilt if a different worker count is asked for.
+WorkerPool& shared_worker_pool(int num_workers);
@@ -0,0 +1,192 @@
+// MIT License
+
+// Copyright (c) 2025 Daniel Issen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "zero_page_states.h"
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <stdexcept>
+#include <new>
+#include <utility>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+static size_t page_size() {
+  static const size_t size = sysconf(_SC_PAGESIZE);
+  return size;
+}
+
+static size_t round_to_pages(Index size) {
+  size_t page = page_size();
+  return (static_cast<size_t>(size) + page - 1) / page * page;
+}
+
+ZeroPageStates::ZeroPageStates(Index size) {
+  resize(size);
+}
+
+ZeroPageStates::ZeroPageStates(Index size, const std::string& spill_dir)
+  : spill_dir_(spill_dir) {
+  open_spill_file();
+  resize(size);
+}
+
+ZeroPageStates::~ZeroPageStates() {
+  if (data_) {
+    munmap(data_, capacity_);
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+ZeroPageStates::ZeroPageStates(ZeroPageStates&& other) noexcept
+  : data_(std::exchange(other.data_, nullptr)),
+    size_(std::exchange(other.size_, 0)),
+    capacity_(std::exchange(other.capacity_, 0)),
+    fd_(std::exchange(other.fd_, -1)),
+    spill_dir_(std::move(other.spill_dir_)) {
+}
+
+ZeroPageStates& ZeroPageStates::operator=(ZeroPageStates&& other) noexcept {
+  std::swap(data_, other.data_);
+  std::swap(size_, other.size_);
+  std::swap(capacity_, other.capacity_);
+  std::swap(fd_, other.fd_);
+  std::swap(spill_dir_, other.spill_dir_);
+  return *this;
+}
+
+// the file is unlinked right away so it goes with the last mapping,
+// however the process ends
+void ZeroPageStates::open_spill_file() {
+  std::string path = spill_dir_ + "/basis_states.XXXXXX";
+  fd_ = mkstemp(&path[0]);
+  if (fd_ < 0) {
+    throw std::runtime_error("cannot create a spill file in " +
+			     spill_dir_ + ": " + std::strerror(errno));
+  }
+  unlink(path.c_str());
+}
+
+// a copy of a spilled store spills to the same directory
+ZeroPageStates::ZeroPageStates(const ZeroPageStates& other)
+  : spill_dir_(other.spill_dir_) {
+  if (!spill_dir_.empty()) {
+    open_spill_file();
+  }
+  resize(other.size_);
+  const size_t page = page_size();
+  for (size_t start = 0; start < other.capacity_; start += page) {
+    const uint8_t* src = other.data_ + start;
+    // reading a zero page commits nothing, writing one would
+    bool zero = true;
+    for (size_t x = 0; x < page && zero; x += sizeof(uint64_t)) {
+      uint64_t word;
+      std::memcpy(&word, src + x, sizeof(word));
+      zero = (word == 0);
+    }
+    if (!zero) {
+      std::memcpy(data_ + start, src, page);
+    }
+  }
+}
+
+ZeroPageStates& ZeroPageStates::operator=(const ZeroPageStates& other) {
+  if (this != &other) {
+    ZeroPageStates copy(other);
+    *this = std::move(copy);
+  }
+  return *this;
+}
+
+bool ZeroPageStates::narrow(const ZeroPageStates& other, bool& changed) {
+  // inverted, so narrowing ORs in the excluded assignments and a
+  // state with nothing left is 0xff
+  bool contradiction = false;
+  for (Index x = 0; x < size_; ++x) {
+    uint8_t excluded = data_[x] | other.data_[x];
+    if (excluded != data_[x]) {
+      data_[x] = excluded;
+      changed = true;
+      contradiction = contradiction || (excluded == 0xff);
+    }
+  }
+  return !contradiction;
+}
+
+void ZeroPageStates::resize(Index size) {
+  if (size <= size_) {
+    return;
+  }
+  // bytes past size_ in the last page were never written, so they
+  // are still zero, i.e. SET_ANY_ANY_ANY
+  size_t capacity = round_to_pages(size);
+  if (capacity > capacity_) {
+    // growing the file adds a hole, which reads as zeros
+    if (fd_ >= 0 && ftruncate(fd_, capacity) != 0) {
+      throw std::runtime_error("cannot grow the spill file in " +
+			       spill_dir_ + ": " + std::strerror(errno));
+    }
+    void* data;
+    if (data_) {
+      data = mremap(data_, capacity_, capacity, MREMAP_MAYMOVE);
+    } else if (fd_ >= 0) {
+      data = mmap(nullptr, capacity, PROT_READ | PROT_WRITE,
+		  MAP_SHARED, fd_, 0);
+    } else {
+      data = mmap(nullptr, capacity, PROT_READ | PROT_WRITE,
+		  MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    }
+    if (data == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+    data_ = static_cast<uint8_t*>(data);
+    capacity_ = capacity;
+  }
+  size_ = size;
+}
+
+// mincore would count pages that were only read, which map the
+// shared zero page, so take the Rss of our mapping from smaps, which
+// leaves the zero page out
+size_t ZeroPageStates::resident_bytes() const {
+  if (!data_) {
+    return 0;
+  }
+  std::ifstream smaps("/proc/self/smaps");
+  std::string line;
+  bool ours = false;
+  while (std::getline(smaps, line)) {
+    unsigned long start, end;
+    if (std::sscanf(line.c_str(), "%lx-%lx", &start, &end) == 2) {
+      ours = start <= reinterpret_cast<unsigned long>(data_) &&
+	reinterpret_cast<unsigned long>(data_) < end;
+    } else if (ours && line.compare(0, 4, "Rss:") == 0) {
+      return std::stoull(line.substr(4)) * 1024;
+    }
+  }
+  return 0;
+}
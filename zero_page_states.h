@@ -0,0 +1,116 @@
+// MIT License
+
+// Copyright (c) 2025 Daniel Issen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// basis_states for large formulas.  a std::vector filled with
+// SET_ANY_ANY_ANY writes every one of its C(n,3) bytes before the
+// solve starts.  ZeroPageStates stores every state inverted, a set bit
+// meaning the assignment is excluded, so SET_ANY_ANY_ANY is a zero
+// byte and a fresh store is an anonymous mapping of kernel zero
+// pages.  creating one is instant and a page only becomes resident
+// once a basis on it actually loses an assignment.
+//
+// Given a spill directory the mapping is a shared one of an unlinked
+// sparse file there instead.  holes read as zero just the same, but
+// the pages we write are page cache the kernel can write back and
+// drop, so a basis_states larger than memory pages instead of
+// getting the process killed.
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "pairing.h"
+
+class ZeroPageStates {
+public:
+  // Write access to one state.  narrowing a state to what it already
+  // is does not touch its page.
+  class Ref {
+  public:
+    explicit Ref(uint8_t* byte) : byte_(byte) {}
+
+    operator uint8_t() const { return ~*byte_; }
+
+    Ref& operator&=(uint8_t mask) {
+      uint8_t excluded = ~mask & ~*byte_;
+      if (excluded) {
+	*byte_ |= excluded;
+      }
+      return *this;
+    }
+
+    // states only ever lose bits, so this is &= under another name
+    Ref& operator=(uint8_t state) { return *this &= state; }
+
+  private:
+    uint8_t* byte_;
+  };
+
+  ZeroPageStates() = default;
+  // size states, all SET_ANY_ANY_ANY
+  explicit ZeroPageStates(Index size);
+  // size states in a file in spill_dir, throws std::runtime_error if
+  // it cannot be created
+  ZeroPageStates(Index size, const std::string& spill_dir);
+  ~ZeroPageStates();
+
+  ZeroPageStates(ZeroPageStates&& other) noexcept;
+  ZeroPageStates& operator=(ZeroPageStates&& other) noexcept;
+  // copies only the pages of other that hold a restricted basis, the
+  // rest of the copy stays on zero pages
+  ZeroPageStates(const ZeroPageStates& other);
+  ZeroPageStates& operator=(const ZeroPageStates& other);
+
+  Index size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  uint8_t operator[](Index idx) const { return ~data_[idx]; }
+  Ref operator[](Index idx) { return Ref(data_ + idx); }
+
+  // Grow to size states, the new ones SET_ANY_ANY_ANY.  the mapping
+  // is moved rather than copied so untouched pages stay zero pages.
+  void resize(Index size);
+
+  // AND the states of other (of the same size) into ours, writing
+  // only the states that lose a bit.  sets changed if any did and
+  // returns false if one went to zero.
+  bool narrow(const ZeroPageStates& other, bool& changed);
+
+  // Bytes of the store that are backed by memory, a multiple of the
+  // page size
+  size_t resident_bytes() const;
+
+  // Bytes the store would take as a std::vector
+  size_t mapped_bytes() const { return static_cast<size_t>(size_); }
+
+  // Directory of the spill file, empty for anonymous memory
+  const std::string& spill_dir() const { return spill_dir_; }
+
+private:
+  void open_spill_file();
+
+  uint8_t* data_ = nullptr;
+  Index size_ = 0;
+  size_t capacity_ = 0;   // mapped bytes, whole pages
+  int fd_ = -1;           // the spill file
+  std::string spill_dir_;
+};